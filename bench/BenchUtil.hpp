@@ -0,0 +1,70 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __BENCH_UTIL_HPP__
+#define __BENCH_UTIL_HPP__
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <sys/resource.h>
+
+// report p50/p99/p99.9/max of the samples (nsec) as the counters in usec
+static inline void setPercentileCounters(benchmark::State& state, std::vector<int64_t>& samples, const std::string& prefix)
+{
+  if( !samples.empty() ){
+    std::sort( samples.begin(), samples.end() );
+    auto getPercentile = [&samples](double percentile){
+      return (double)samples[ std::min( samples.size() - 1, (size_t)( samples.size() * percentile ) ) ] / 1000.0;
+    };
+    state.counters[ prefix + "_p50_us" ] = getPercentile( 0.5 );
+    state.counters[ prefix + "_p99_us" ] = getPercentile( 0.99 );
+    state.counters[ prefix + "_p999_us" ] = getPercentile( 0.999 );
+    state.counters[ prefix + "_max_us" ] = (double)samples.back() / 1000.0;
+  }
+}
+
+// the standard deviation of the samples (nsec) in usec
+static inline double getStdDev(const std::vector<int64_t>& samples)
+{
+  double result = 0.0;
+  if( samples.size() > 1 ){
+    double mean = 0.0;
+    for( int64_t nSample : samples ){
+      mean += nSample;
+    }
+    mean /= samples.size();
+    for( int64_t nSample : samples ){
+      result += ( nSample - mean ) * ( nSample - mean );
+    }
+    result = std::sqrt( result / ( samples.size() - 1 ) ) / 1000.0;
+  }
+  return result;
+}
+
+// user + system CPU time of this process
+static inline std::chrono::microseconds getProcessCpuTime(void)
+{
+  struct rusage usage;
+  getrusage( RUSAGE_SELF, &usage );
+  return std::chrono::seconds( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) + std::chrono::microseconds( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec );
+}
+
+#endif /* __BENCH_UTIL_HPP__ */
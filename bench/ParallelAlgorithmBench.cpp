@@ -0,0 +1,73 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include <benchmark/benchmark.h>
+#include "ThreadPool.hpp"
+#include "ParallelAlgorithm.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// the scaling of parallel_for : range(0) is the number of threads, 0 is the serial loop on the caller
+static void BM_ParallelFor(benchmark::State& state)
+{
+  const int nSize = 1 << 20;
+  std::vector<double> values( nSize, 0.0 );
+  std::shared_ptr<ThreadPool> pThreadPool = state.range(0) ? std::make_shared<ThreadPool>( state.range(0) ) : nullptr;
+  if( pThreadPool ){
+    pThreadPool->execute();
+  }
+
+  for( auto _ : state ){
+    parallel_for( pThreadPool, 0, nSize, 1024, [&values](int i){ values[i] = std::sqrt( (double)i ) * std::sin( (double)i ); } );
+    benchmark::DoNotOptimize( values.data() );
+  }
+  state.SetItemsProcessed( state.iterations() * nSize );
+
+  if( pThreadPool ){
+    pThreadPool->terminate();
+  }
+}
+BENCHMARK(BM_ParallelFor)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// the scaling of parallel_reduce : range(0) is the number of threads, 0 is the serial loop on the caller
+static void BM_ParallelReduce(benchmark::State& state)
+{
+  const int nSize = 1 << 22;
+  std::vector<double> values( nSize, 1.0 );
+  std::shared_ptr<ThreadPool> pThreadPool = state.range(0) ? std::make_shared<ThreadPool>( state.range(0) ) : nullptr;
+  if( pThreadPool ){
+    pThreadPool->execute();
+  }
+
+  for( auto _ : state ){
+    double sum = parallel_reduce( pThreadPool, 0, nSize, 4096, 0.0, [&values](int nBegin, int nEnd, double value){
+      for( int i = nBegin; i < nEnd; i++ ){
+        value += values[i];
+      }
+      return value;
+    }, [](double a, double b){ return a + b; } );
+    benchmark::DoNotOptimize( sum );
+  }
+  state.SetItemsProcessed( state.iterations() * nSize );
+
+  if( pThreadPool ){
+    pThreadPool->terminate();
+  }
+}
+BENCHMARK(BM_ParallelReduce)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,50 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <benchmark/benchmark.h>
+#include "Task.hpp"
+#include "Timer.hpp"
+#include "LambdaTask.hpp"
+
+#include <memory>
+
+// the per-dispatch cost to know the queued ITask is a Task : RTTI + shared_ptr copy vs the capability pointer
+static std::shared_ptr<ITask> makeQueuedTask(void)
+{
+  return std::make_shared<LambdaTimer>( [](std::shared_ptr<Task> pTask){}, 100, false );
+}
+
+static void BM_TaskCapabilityDynamicCast(benchmark::State& state)
+{
+  std::shared_ptr<ITask> pTask = makeQueuedTask();
+
+  for( auto _ : state ){
+    std::shared_ptr<Task> pFullTask = std::dynamic_pointer_cast<Task>( pTask );
+    benchmark::DoNotOptimize( pFullTask );
+  }
+}
+BENCHMARK(BM_TaskCapabilityDynamicCast);
+
+static void BM_TaskCapabilityTag(benchmark::State& state)
+{
+  std::shared_ptr<ITask> pTask = makeQueuedTask();
+
+  for( auto _ : state ){
+    Task* pFullTask = pTask->getTask();
+    benchmark::DoNotOptimize( pFullTask );
+  }
+}
+BENCHMARK(BM_TaskCapabilityTag);
@@ -0,0 +1,62 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include <benchmark/benchmark.h>
+#include "ThreadPool.hpp"
+#include "TaskGraph.hpp"
+#include "LambdaTask.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+static void spinFor(std::chrono::microseconds duration)
+{
+  std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() + duration;
+  while( std::chrono::steady_clock::now() < endTime );
+}
+
+// the chain of the diamonds (fan-out to range(1) nodes and join) re-run per iteration : range(0) is the number of threads
+static void BM_TaskGraphDiamond(benchmark::State& state)
+{
+  const int nNumOfDiamonds = 16;
+  const int nWidth = state.range(1);
+  const std::chrono::microseconds work( 10 );
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( state.range(0) );
+  pThreadPool->execute();
+
+  TaskGraph graph;
+  std::shared_ptr<TaskGraph::Node> pJoin = graph.addNode( std::make_shared<LambdaTask>( [work](std::shared_ptr<Task> pTask){ spinFor( work ); } ) );
+  for( int i = 0; i < nNumOfDiamonds; i++ ){
+    std::shared_ptr<TaskGraph::Node> pNextJoin = graph.addNode( std::make_shared<LambdaTask>( [work](std::shared_ptr<Task> pTask){ spinFor( work ); } ) );
+    for( int j = 0; j < nWidth; j++ ){
+      std::shared_ptr<TaskGraph::Node> pNode = graph.addNode( std::make_shared<LambdaTask>( [work](std::shared_ptr<Task> pTask){ spinFor( work ); } ) );
+      pNode->addPredecessor( pJoin );
+      pNextJoin->addPredecessor( pNode );
+    }
+    pJoin = pNextJoin;
+  }
+
+  for( auto _ : state ){
+    graph.run( pThreadPool );
+    graph.wait();
+  }
+  state.SetItemsProcessed( state.iterations() * graph.getNumOfNodes() );
+
+  pThreadPool->terminate();
+}
+BENCHMARK(BM_TaskGraphDiamond)->ArgsProduct({ {1, 4}, {1, 8} })->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,111 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <benchmark/benchmark.h>
+#include "TaskManager.hpp"
+#include "ThreadPool.hpp"
+#include "LambdaTask.hpp"
+#include "BenchUtil.hpp"
+
+#include <thread>
+#include <vector>
+
+class BenchSpinTask : public Task
+{
+public:
+  virtual void onExecute(void)
+  {
+    while( !mStopRunning ){
+      std::this_thread::yield();
+    }
+  }
+};
+
+// the running task's cancelTask() until it returns
+static void BM_TaskManagerCancelLatency(benchmark::State& state)
+{
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( 1 );
+  std::vector<int64_t> samples;
+
+  for( auto _ : state ){
+    std::shared_ptr<Task> pTask = std::make_shared<BenchSpinTask>();
+    pTaskMan->addTask( pTask );
+    pTaskMan->executeAllTasks();
+    while( !pTask->isRunning() ){
+      std::this_thread::yield();
+    }
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    pTaskMan->cancelTask( pTask );
+    std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startTime;
+
+    state.SetIterationTime( std::chrono::duration<double>( duration ).count() );
+    samples.push_back( duration.count() );
+  }
+  setPercentileCounters( state, samples, "cancel" );
+
+  pTaskMan->finalize();
+}
+BENCHMARK(BM_TaskManagerCancelLatency)->Iterations(200)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+// stopAllTasks() for range(0) running tasks
+static void BM_TaskManagerStopAllTasks(benchmark::State& state)
+{
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( state.range(0) );
+
+  for( auto _ : state ){
+    std::vector<std::shared_ptr<Task>> tasks;
+    for( int i = 0; i < state.range(0); i++ ){
+      tasks.push_back( std::make_shared<BenchSpinTask>() );
+      pTaskMan->addTask( tasks.back() );
+    }
+    pTaskMan->executeAllTasks();
+    for( auto& pTask : tasks ){
+      while( !pTask->isRunning() ){
+        std::this_thread::yield();
+      }
+    }
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    pTaskMan->stopAllTasks();
+    state.SetIterationTime( std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count() );
+  }
+
+  pTaskMan->finalize();
+}
+BENCHMARK(BM_TaskManagerStopAllTasks)->Arg(4)->Arg(32)->Iterations(20)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+// short tasks through TaskManager : range(0) is mMaxThread
+static void BM_TaskManagerThroughput(benchmark::State& state)
+{
+  const int nNumOfTasks = 10000;
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( state.range(0) );
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfTasks;
+    for( int i = 0; i < nNumOfTasks; i++ ){
+      pTaskMan->addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1, std::memory_order_relaxed ); } ) );
+    }
+    pTaskMan->executeAllTasks();
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * nNumOfTasks );
+
+  pTaskMan->finalize();
+}
+BENCHMARK(BM_TaskManagerThroughput)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
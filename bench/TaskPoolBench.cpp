@@ -0,0 +1,92 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <benchmark/benchmark.h>
+#include "ThreadPool.hpp"
+#include "LockFreeTaskPool.hpp"
+#include "PriorityTaskPool.hpp"
+#include "DeadlineTaskPool.hpp"
+#include "WorkStealing.hpp"
+
+class EmptyTask : public ITask
+{
+public:
+  virtual void onExecute(void){};
+};
+
+// every benchmark thread is both of producer and consumer of the shared pool
+template <class T>
+static void BM_TaskPoolContention(benchmark::State& state)
+{
+  static std::shared_ptr<ThreadPool::TaskPool> pTaskPool = std::make_shared<T>();
+  std::shared_ptr<ITask> pTask = std::make_shared<EmptyTask>();
+
+  if( state.thread_index() == 0 ){
+    pTaskPool->clear();
+  }
+  for( auto _ : state ){
+    pTaskPool->enqueue( pTask );
+    benchmark::DoNotOptimize( pTaskPool->dequeue() );
+  }
+  state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK_TEMPLATE(BM_TaskPoolContention, ThreadPool::TaskPool)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolContention, LockFreeTaskPool)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolContention, PriorityTaskPool)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolContention, DeadlineTaskPool)->ThreadRange(1, 16)->UseRealTime();
+
+// separated producers and consumers : the even threads enqueue and the odd threads dequeue the same number of tasks
+template <class T>
+static void BM_TaskPoolProducerConsumer(benchmark::State& state)
+{
+  static std::shared_ptr<ThreadPool::TaskPool> pTaskPool = std::make_shared<T>();
+  std::shared_ptr<ITask> pTask = std::make_shared<EmptyTask>();
+  bool bProducer = ( state.thread_index() % 2 ) == 0;
+
+  if( state.thread_index() == 0 ){
+    pTaskPool->clear();
+  }
+  for( auto _ : state ){
+    if( bProducer ){
+      pTaskPool->enqueue( pTask );
+    } else {
+      while( !pTaskPool->dequeue() );
+    }
+  }
+  state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK_TEMPLATE(BM_TaskPoolProducerConsumer, ThreadPool::TaskPool)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolProducerConsumer, LockFreeTaskPool)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolProducerConsumer, PriorityTaskPool)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TaskPoolProducerConsumer, DeadlineTaskPool)->ThreadRange(2, 16)->UseRealTime();
+
+// the owner's push and pop of the work-stealing deque : range(0) is the number of the tasks pushed before popping them
+static void BM_WorkStealingDequePushPop(benchmark::State& state)
+{
+  WorkStealingDeque deque;
+  std::shared_ptr<ITask> pTask = std::make_shared<EmptyTask>();
+
+  for( auto _ : state ){
+    for( int i = 0; i < state.range(0); i++ ){
+      deque.push( pTask );
+    }
+    for( int i = 0; i < state.range(0); i++ ){
+      benchmark::DoNotOptimize( deque.pop() );
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(BM_WorkStealingDequePushPop)->Arg(1)->Arg(64)->Arg(1024);
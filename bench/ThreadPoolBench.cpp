@@ -0,0 +1,290 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <benchmark/benchmark.h>
+#include "ThreadPool.hpp"
+#include "LambdaTask.hpp"
+#include "PriorityTaskPool.hpp"
+#include "BenchUtil.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static void forkRecursively(ThreadPool* pThreadPool, std::atomic<int>* pCounter, int nDepth)
+{
+  pThreadPool->addTask( std::make_shared<LambdaTask>( [pThreadPool, pCounter, nDepth](std::shared_ptr<Task> pTask){
+    if( nDepth > 0 ){
+      forkRecursively( pThreadPool, pCounter, nDepth - 1 );
+      forkRecursively( pThreadPool, pCounter, nDepth - 1 );
+    }
+    pCounter->fetch_sub( 1 );
+  } ) );
+}
+
+// binary fork tree of 2^(depth+1)-1 tasks : range(0) is the number of threads, range(1) is work-stealing or not
+static void BM_ThreadPoolForkJoin(benchmark::State& state)
+{
+  const int nDepth = 12;
+  ThreadPool threadPool( state.range(0), state.range(1) != 0 );
+  threadPool.execute();
+
+  for( auto _ : state ){
+    std::atomic<int> counter = ( 1 << ( nDepth + 1 ) ) - 1;
+    forkRecursively( &threadPool, &counter, nDepth );
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * ( ( 1 << ( nDepth + 1 ) ) - 1 ) );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolForkJoin)->ArgsProduct({ {1, 2, 4, 8}, {0, 1} })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// dispatch 10000 small tasks : range(0) = 0 for LambdaTask, 1 for InplaceTask queued by value, 2 for LambdaTask from ObjectPool
+static void BM_ThreadPoolDispatch(benchmark::State& state)
+{
+  const int nNumOfTasks = 10000;
+  ThreadPool threadPool( 2 );
+  threadPool.execute();
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfTasks;
+    for( int i = 0; i < nNumOfTasks; i++ ){
+      if( state.range(0) == 1 ){
+        threadPool.addTask( [&counter](){ counter.fetch_sub( 1 ); } );
+      } else if( state.range(0) == 2 ){
+        threadPool.addTask( ThreadPool::makeTask<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1 ); } ) );
+      } else {
+        threadPool.addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1 ); } ) );
+      }
+    }
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * nNumOfTasks );
+  if( state.range(0) == 2 ){
+    state.counters["pool_hit_rate"] = ObjectPool::getStatistics().getHitRate();
+  }
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolDispatch)->Arg(0)->Arg(1)->Arg(2)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// empty task dispatch throughput : range(0) is the number of threads
+static void BM_ThreadPoolThroughput(benchmark::State& state)
+{
+  const int nNumOfTasks = 10000;
+  ThreadPool threadPool( state.range(0) );
+  threadPool.execute();
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfTasks;
+    for( int i = 0; i < nNumOfTasks; i++ ){
+      threadPool.addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1, std::memory_order_relaxed ); } ) );
+    }
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * nNumOfTasks );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolThroughput)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// the high priority task's start latency behind 100 low priority 20usec tasks : range(0) is 0=TaskPool, 1=PriorityTaskPool
+static void BM_ThreadPoolPriorityLatency(benchmark::State& state)
+{
+  const int nNumOfLowTasks = 100;
+  std::shared_ptr<ThreadPool::TaskPool> pTaskPool = state.range(0) ? std::make_shared<PriorityTaskPool>() : std::make_shared<ThreadPool::TaskPool>();
+  ThreadPool threadPool( 2, pTaskPool );
+  threadPool.execute();
+  std::vector<int64_t> samples;
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfLowTasks;
+    for( int i = 0; i < nNumOfLowTasks; i++ ){
+      std::shared_ptr<Task> pTask = std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){
+        std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() + std::chrono::microseconds( 20 );
+        while( std::chrono::steady_clock::now() < endTime );
+        counter--;
+      } );
+      pTask->setPriority( ITask::PRIORITY_LOW );
+      threadPool.addTask( pTask );
+    }
+
+    std::atomic<int64_t> nLatency = -1;
+    std::chrono::steady_clock::time_point enqueueTime = std::chrono::steady_clock::now();
+    std::shared_ptr<Task> pHighTask = std::make_shared<LambdaTask>( [&nLatency, enqueueTime](std::shared_ptr<Task> pTask){
+      nLatency = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - enqueueTime ).count();
+    } );
+    pHighTask->setPriority( ITask::PRIORITY_HIGH );
+    threadPool.addTask( pHighTask );
+    while( nLatency < 0 || counter > 0 ){
+      std::this_thread::yield();
+    }
+    samples.push_back( nLatency );
+    state.SetIterationTime( nLatency / 1e9 );
+  }
+  setPercentileCounters( state, samples, "start" );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolPriorityLatency)->Arg(0)->Arg(1)->Iterations(50)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+// the cost of enableMetrics() on the empty task dispatch : range(0) is 0=disabled, 1=enabled
+static void BM_ThreadPoolMetrics(benchmark::State& state)
+{
+  const int nNumOfTasks = 10000;
+  ThreadPool threadPool( 2 );
+  threadPool.enableMetrics( state.range(0) );
+  threadPool.execute();
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfTasks;
+    for( int i = 0; i < nNumOfTasks; i++ ){
+      threadPool.addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1, std::memory_order_relaxed ); } ) );
+    }
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * nNumOfTasks );
+
+  ThreadPool::Metrics metrics = threadPool.getMetrics();
+  state.counters["utilization"] = metrics.getUtilization();
+  state.counters["wait_p99_us"] = metrics.waitLatency.getPercentile( 99 ).count() / 1000.0;
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolMetrics)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// addTask() one by one vs addTasks() : range(0) is 0=addTask(), 1=addTasks(), range(1) is the dequeue batch size
+static void BM_ThreadPoolBatch(benchmark::State& state)
+{
+  const int nNumOfTasks = 10000;
+  ThreadPool threadPool( 4 );
+  threadPool.setDequeueBatchSize( state.range(1) );
+  threadPool.execute();
+
+  for( auto _ : state ){
+    std::atomic<int> counter = nNumOfTasks;
+    std::vector<std::shared_ptr<ITask>> tasks;
+    tasks.reserve( nNumOfTasks );
+    for( int i = 0; i < nNumOfTasks; i++ ){
+      tasks.push_back( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter.fetch_sub( 1, std::memory_order_relaxed ); } ) );
+    }
+    if( state.range(0) ){
+      threadPool.addTasks( tasks );
+    } else {
+      for( auto& pTask : tasks ){
+        threadPool.addTask( pTask );
+      }
+    }
+    while( counter > 0 ){
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * nNumOfTasks );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolBatch)->ArgsProduct({ {0, 1}, {1, 8} })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// addTask() to the start of onExecute() one by one : range(0) is the number of threads, range(1) is the interval in usec to let the workers park
+static void BM_ThreadPoolStartLatency(benchmark::State& state)
+{
+  const int nNumOfSamples = 1000;
+  ThreadPool threadPool( state.range(0) );
+  threadPool.execute();
+  std::vector<int64_t> samples;
+
+  for( auto _ : state ){
+    for( int i = 0; i < nNumOfSamples; i++ ){
+      std::atomic<int64_t> nLatency = -1;
+      std::chrono::steady_clock::time_point enqueueTime = std::chrono::steady_clock::now();
+      threadPool.addTask( std::make_shared<LambdaTask>( [&nLatency, enqueueTime](std::shared_ptr<Task> pTask){
+        nLatency = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - enqueueTime ).count();
+      } ) );
+      while( nLatency < 0 ){
+        std::this_thread::yield();
+      }
+      samples.push_back( nLatency );
+      if( state.range(1) ){
+        std::this_thread::sleep_for( std::chrono::microseconds( state.range(1) ) );
+      }
+    }
+  }
+  setPercentileCounters( state, samples, "start" );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolStartLatency)->ArgsProduct({ {1, 4}, {0, 1000} })->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// the start latency with and without pinning : range(0) is ThreadPool::AffinityPolicy, the workers are round-robin over the available CPUs
+static void BM_ThreadPoolAffinityLatency(benchmark::State& state)
+{
+  const int nNumOfSamples = 2000;
+  ThreadPool::Config config( 4 );
+  config.affinityPolicy = (ThreadPool::AffinityPolicy)state.range(0);
+  ThreadPool threadPool( config );
+  threadPool.execute();
+  std::vector<int64_t> samples;
+
+  for( auto _ : state ){
+    for( int i = 0; i < nNumOfSamples; i++ ){
+      std::atomic<int64_t> nLatency = -1;
+      std::chrono::steady_clock::time_point enqueueTime = std::chrono::steady_clock::now();
+      threadPool.addTask( InplaceTask( [&nLatency, enqueueTime](){
+        nLatency = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - enqueueTime ).count();
+      } ) );
+      while( nLatency < 0 ){
+        std::this_thread::yield();
+      }
+      samples.push_back( nLatency );
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+    }
+  }
+  state.counters["start_stddev_us"] = getStdDev( samples );
+  setPercentileCounters( state, samples, "start" );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolAffinityLatency)->Arg(ThreadPool::AFFINITY_NONE)->Arg(ThreadPool::AFFINITY_ROUND_ROBIN)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// CPU usage of the idle workers : range(0) is the number of threads
+static void BM_ThreadPoolIdleCpu(benchmark::State& state)
+{
+  const std::chrono::milliseconds idleDuration( 200 );
+  ThreadPool threadPool( state.range(0) );
+  threadPool.execute();
+  // let the workers finish the initial spin and park
+  std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+  std::chrono::microseconds cpuTime( 0 );
+  for( auto _ : state ){
+    std::chrono::microseconds startCpuTime = getProcessCpuTime();
+    std::this_thread::sleep_for( idleDuration );
+    cpuTime += getProcessCpuTime() - startCpuTime;
+  }
+  state.counters["cpu_percent"] = 100.0 * cpuTime.count() / ( std::chrono::duration_cast<std::chrono::microseconds>( idleDuration ).count() * state.iterations() );
+
+  threadPool.terminate();
+}
+BENCHMARK(BM_ThreadPoolIdleCpu)->Arg(1)->Arg(8)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
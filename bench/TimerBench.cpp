@@ -0,0 +1,118 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <benchmark/benchmark.h>
+#include "Timer.hpp"
+#include "PeriodicTask.hpp"
+#include "LambdaTask.hpp"
+#include "BenchUtil.hpp"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// |interval - period| of the consecutive fire times in nsec
+static std::vector<int64_t> getJitters(std::vector<std::chrono::steady_clock::time_point>& fireTimes, std::chrono::nanoseconds period)
+{
+  std::vector<int64_t> jitters;
+
+  for( size_t i = 1; i < fireTimes.size(); i++ ){
+    jitters.push_back( std::abs( ( std::chrono::duration_cast<std::chrono::nanoseconds>( fireTimes[i] - fireTimes[i - 1] ) - period ).count() ) );
+  }
+
+  return jitters;
+}
+
+// repeated Timer's firing jitter : range(0) is the period in usec
+static void BM_TimerJitter(benchmark::State& state)
+{
+  const std::chrono::microseconds period( state.range(0) );
+  const int nNumOfFires = std::max( 10, (int)( std::chrono::milliseconds( 500 ) / period ) );
+  std::vector<int64_t> jitters;
+
+  for( auto _ : state ){
+    std::mutex mutex;
+    std::vector<std::chrono::steady_clock::time_point> fireTimes;
+    std::shared_ptr<LambdaTimer> pTimer = std::make_shared<LambdaTimer>( [&](std::shared_ptr<Task> pTask){
+      std::lock_guard<std::mutex> lock( mutex );
+      fireTimes.push_back( std::chrono::steady_clock::now() );
+    }, period, true );
+
+    pTimer->schedule();
+    std::this_thread::sleep_for( period * nNumOfFires + period / 2 );
+    pTimer->cancelSchedule();
+
+    std::lock_guard<std::mutex> lock( mutex );
+    std::vector<int64_t> aJitters = getJitters( fireTimes, period );
+    jitters.insert( jitters.end(), aJitters.begin(), aJitters.end() );
+  }
+  setPercentileCounters( state, jitters, "jitter" );
+}
+BENCHMARK(BM_TimerJitter)->Arg(250)->Arg(1000)->Arg(10000)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// PeriodicTaskManager's jitter : range(0) is the period in usec, range(1) is the spin duration in usec
+static void BM_PeriodicTaskJitter(benchmark::State& state)
+{
+  const std::chrono::microseconds period( state.range(0) );
+  const int nNumOfFires = std::max( 10, (int)( std::chrono::milliseconds( 500 ) / period ) );
+  std::vector<int64_t> jitters;
+
+  for( auto _ : state ){
+    std::vector<std::chrono::steady_clock::time_point> fireTimes;
+    std::shared_ptr<PeriodicTaskManager> pTaskMan = std::make_shared<PeriodicTaskManager>( PeriodicTask::OverrunPolicy::COALESCE, std::chrono::microseconds( state.range(1) ) );
+    pTaskMan->scheduleRepeat( std::make_shared<LambdaTask>( [&fireTimes](std::shared_ptr<Task> pTask){
+      fireTimes.push_back( std::chrono::steady_clock::now() );
+    } ), period );
+
+    pTaskMan->execute();
+    std::this_thread::sleep_for( period * nNumOfFires + period / 2 );
+    pTaskMan->terminate();
+
+    std::vector<int64_t> aJitters = getJitters( fireTimes, period );
+    jitters.insert( jitters.end(), aJitters.begin(), aJitters.end() );
+  }
+  setPercentileCounters( state, jitters, "jitter" );
+}
+BENCHMARK(BM_PeriodicTaskJitter)->ArgsProduct({ {250, 1000}, {0, 50} })->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// the jitter of the 1msec period with and without pinning its thread : range(0) is 0=not pinned, 1=pinned to the last available CPU
+static void BM_PeriodicTaskAffinityJitter(benchmark::State& state)
+{
+  const std::chrono::microseconds period( 1000 );
+  const int nNumOfFires = 500;
+  std::vector<int64_t> jitters;
+
+  for( auto _ : state ){
+    std::vector<std::chrono::steady_clock::time_point> fireTimes;
+    std::shared_ptr<PeriodicTaskManager> pTaskMan = std::make_shared<PeriodicTaskManager>();
+    if( state.range(0) ){
+      pTaskMan->setAffinity( period, { ThreadPool::getAvailableCpus().back() } );
+    }
+    pTaskMan->scheduleRepeat( std::make_shared<LambdaTask>( [&fireTimes](std::shared_ptr<Task> pTask){
+      fireTimes.push_back( std::chrono::steady_clock::now() );
+    } ), period );
+
+    pTaskMan->execute();
+    std::this_thread::sleep_for( period * nNumOfFires + period / 2 );
+    pTaskMan->terminate();
+
+    std::vector<int64_t> aJitters = getJitters( fireTimes, period );
+    jitters.insert( jitters.end(), aJitters.begin(), aJitters.end() );
+  }
+  state.counters["jitter_stddev_us"] = getStdDev( jitters );
+  setPercentileCounters( state, jitters, "jitter" );
+}
+BENCHMARK(BM_PeriodicTaskAffinityJitter)->Arg(0)->Arg(1)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
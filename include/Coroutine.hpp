@@ -0,0 +1,203 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __COROUTINE_HPP__
+#define __COROUTINE_HPP__
+
+#include "Task.hpp"
+#include "Future.hpp"
+
+#include <mutex>
+#include <optional>
+#include <exception>
+#include <condition_variable>
+
+// the awaitable types are available when the compiler supports the coroutine
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+// ASYNC_TASK_COROUTINE_NS is the namespace of coroutine_handle without adding the alias to the global namespace
+#define ASYNC_TASK_COROUTINE 1
+#define ASYNC_TASK_COROUTINE_NS std
+#elif __has_include(<experimental/coroutine>)
+#include <experimental/coroutine>
+#define ASYNC_TASK_COROUTINE 1
+#define ASYNC_TASK_COROUTINE_NS std::experimental
+#endif
+
+#if ASYNC_TASK_COROUTINE
+
+// the coroutine returning T. it starts lazily by co_await from the other coroutine or by start()/get()
+template<typename T = void>
+class CoTask
+{
+public:
+  class PromiseBase
+  {
+  public:
+    std::exception_ptr mException;
+    ASYNC_TASK_COROUTINE_NS::coroutine_handle<> mContinuation;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mIsDone = false;
+
+    struct FinalAwaiter
+    {
+      bool await_ready(void) noexcept { return false; };
+      template<typename PROMISE>
+      ASYNC_TASK_COROUTINE_NS::coroutine_handle<> await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<PROMISE> handle) noexcept
+      {
+        // the waiter of get() may destroy the frame after the unlock, then nothing in the promise is touched after that
+        PromiseBase& promise = handle.promise();
+        ASYNC_TASK_COROUTINE_NS::coroutine_handle<> continuation = promise.mContinuation;
+        {
+          std::lock_guard<std::mutex> lock( promise.mMutex );
+          promise.mIsDone = true;
+          promise.mCondition.notify_all();
+        }
+        return continuation ? continuation : ASYNC_TASK_COROUTINE_NS::noop_coroutine();
+      };
+      void await_resume(void) noexcept {};
+    };
+
+    ASYNC_TASK_COROUTINE_NS::suspend_always initial_suspend(void) noexcept { return {}; };
+    FinalAwaiter final_suspend(void) noexcept { return {}; };
+    void unhandled_exception(void){ mException = std::current_exception(); };
+  };
+
+  class PromiseValue : public PromiseBase
+  {
+  public:
+    std::optional<T> mValue;
+    CoTask get_return_object(void){ return CoTask( ASYNC_TASK_COROUTINE_NS::coroutine_handle<promise_type>::from_promise( static_cast<promise_type&>( *this ) ) ); };
+    void return_value(T value){ mValue = std::move( value ); };
+  };
+
+  class PromiseVoid : public PromiseBase
+  {
+  public:
+    CoTask get_return_object(void){ return CoTask( ASYNC_TASK_COROUTINE_NS::coroutine_handle<promise_type>::from_promise( static_cast<promise_type&>( *this ) ) ); };
+    void return_void(void){};
+  };
+
+  class promise_type : public std::conditional_t<std::is_void_v<T>, PromiseVoid, PromiseValue>
+  {
+  };
+
+protected:
+  ASYNC_TASK_COROUTINE_NS::coroutine_handle<promise_type> mHandle;
+  bool mIsStarted;
+
+protected:
+  T getResult(void)
+  {
+    if( mHandle.promise().mException ){
+      std::rethrow_exception( mHandle.promise().mException );
+    }
+    if constexpr ( !std::is_void_v<T> ){
+      return std::move( *mHandle.promise().mValue );
+    }
+  }
+
+public:
+  explicit CoTask(ASYNC_TASK_COROUTINE_NS::coroutine_handle<promise_type> handle = nullptr) : mHandle( handle ), mIsStarted( false ) {};
+  CoTask(CoTask&& task) noexcept : mHandle( task.mHandle ), mIsStarted( task.mIsStarted ) { task.mHandle = nullptr; };
+  CoTask(const CoTask&) = delete;
+  CoTask& operator=(const CoTask&) = delete;
+  // the started coroutine is waited for its completion before the destruction
+  virtual ~CoTask()
+  {
+    if( mHandle ){
+      if( mIsStarted ){
+        wait();
+      }
+      mHandle.destroy();
+    }
+  }
+
+  // run on the caller's thread until its first suspension
+  void start(void)
+  {
+    if( mHandle && !mIsStarted ){
+      mIsStarted = true;
+      mHandle.resume();
+    }
+  }
+
+  bool isDone(void)
+  {
+    std::lock_guard<std::mutex> lock( mHandle.promise().mMutex );
+    return mHandle.promise().mIsDone;
+  }
+
+  void wait(void)
+  {
+    start();
+    std::unique_lock<std::mutex> lock( mHandle.promise().mMutex );
+    mHandle.promise().mCondition.wait( lock, [&]{ return mHandle.promise().mIsDone; } );
+  }
+
+  // block the caller until the coroutine returns. rethrow its exception
+  T get(void)
+  {
+    wait();
+    return getResult();
+  }
+
+  // co_await from the other coroutine : this starts and resumes the awaiter when it returns
+  auto operator co_await(void) && noexcept
+  {
+    struct Awaiter
+    {
+      CoTask& mTask;
+      bool await_ready(void) noexcept { return false; };
+      ASYNC_TASK_COROUTINE_NS::coroutine_handle<> await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> awaiter) noexcept
+      {
+        mTask.mIsStarted = true;
+        mTask.mHandle.promise().mContinuation = awaiter;
+        return mTask.mHandle;
+      };
+      T await_resume(void){ return mTask.getResult(); };
+    };
+    return Awaiter{ *this };
+  }
+};
+
+// co_await the Future : the awaiter is resumed on the thread completing the Future
+template<typename T>
+auto operator co_await(Future<T> future)
+{
+  class ResumeTask : public ITask
+  {
+  protected:
+    ASYNC_TASK_COROUTINE_NS::coroutine_handle<> mHandle;
+  public:
+    ResumeTask(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> handle) : mHandle( handle ) {};
+    virtual void onExecute(void){ mHandle.resume(); };
+  };
+
+  struct Awaiter
+  {
+    Future<T> mFuture;
+    bool await_ready(void){ return mFuture.isReady(); };
+    void await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> handle){ mFuture.addContinuation( std::make_shared<ResumeTask>( handle ) ); };
+    T await_resume(void){ return mFuture.get(); };
+  };
+  return Awaiter{ future };
+}
+
+#endif /* ASYNC_TASK_COROUTINE */
+
+#endif /* __COROUTINE_HPP__ */
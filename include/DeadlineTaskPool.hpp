@@ -0,0 +1,61 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __DEADLINE_TASK_POOL_HPP__
+#define __DEADLINE_TASK_POOL_HPP__
+
+#include "ThreadPool.hpp"
+
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+// earliest deadline first by ITask::getDeadline() with the binary heap. the task without the deadline is executed after them in FIFO
+// the task past its deadline at dequeue() is flagged by setDeadlineMissed(), and dropped with onComplete() if bDropMissed
+class DeadlineTaskPool : public ThreadPool::TaskPool
+{
+protected:
+  struct DeadlineTask : public QueuedTask
+  {
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  std::vector<DeadlineTask> mHeap;
+  std::atomic<size_t> mNumOfTasks;
+  bool mDropMissed;
+  std::atomic<uint64_t> mNumOfDeadlineMisses;
+
+protected:
+  static bool isLater(const DeadlineTask& aTask1, const DeadlineTask& aTask2);
+  // they're called with mTaskMutex locked. popTask() returns false if empty, and pTask is null if it's dropped
+  void pushTask(std::shared_ptr<ITask>& pTask);
+  bool popTask(std::shared_ptr<ITask>& pTask, std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<ITask>>& droppedTasks);
+
+public:
+  DeadlineTaskPool(bool bDropMissed = true);
+  virtual ~DeadlineTaskPool();
+  virtual void enqueue(std::shared_ptr<ITask> pTask);
+  virtual std::shared_ptr<ITask> dequeue(void);
+  virtual void enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks);
+  virtual size_t dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks);
+  virtual bool erase(std::shared_ptr<ITask> pTask);
+  virtual void clear(void);
+  virtual bool isEmpty(void);
+  virtual size_t getDepth(void);
+  virtual uint64_t getNumOfDeadlineMisses(void){ return mNumOfDeadlineMisses.load( std::memory_order_relaxed ); };
+};
+
+#endif /* __DEADLINE_TASK_POOL_HPP__ */
@@ -0,0 +1,232 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __FUTURE_HPP__
+#define __FUTURE_HPP__
+
+#include "Task.hpp"
+#include "ObjectPool.hpp"
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+// thrown by Future::get() when DeadlineTaskPool dropped the task past its deadline
+class DeadlineMissedException : public std::runtime_error
+{
+public:
+  DeadlineMissedException() : std::runtime_error( "the task was dropped by its deadline" ) {};
+};
+
+// the shared state of Future : it's also the ITask which produces the result
+template<typename T>
+class FutureState : public ITask
+{
+protected:
+  typedef std::conditional_t<std::is_void_v<T>, bool, T> VALUE;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mIsReady;
+  // onExecute() and the abandon set the result exactly once
+  std::atomic<bool> mIsClaimed;
+  std::optional<VALUE> mValue;
+  std::exception_ptr mException;
+  // executed inline by the thread completing this
+  std::vector<std::shared_ptr<ITask>> mContinuations;
+
+protected:
+  // true for the first caller only
+  bool claim(void){ return !mIsClaimed.exchange( true ); };
+
+  void complete(void)
+  {
+    std::vector<std::shared_ptr<ITask>> continuations;
+
+    mMutex.lock();
+      mIsReady = true;
+      continuations.swap( mContinuations );
+    mMutex.unlock();
+    mCondition.notify_all();
+
+    for( auto& pContinuation : continuations ){
+      pContinuation->onExecute();
+    }
+  }
+
+  void setValue(VALUE value)
+  {
+    mValue = std::move( value );
+    complete();
+  }
+
+  void setException(std::exception_ptr pException)
+  {
+    mException = pException;
+    complete();
+  }
+
+public:
+  FutureState() : mIsReady( false ), mIsClaimed( false ) {};
+  virtual ~FutureState(){};
+
+  bool isReady(void)
+  {
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mIsReady;
+  }
+
+  void wait(void)
+  {
+    std::unique_lock<std::mutex> lock( mMutex );
+    mCondition.wait( lock, [&]{ return mIsReady; } );
+  }
+
+  bool waitFor(std::chrono::nanoseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock( mMutex );
+    return mCondition.wait_for( lock, timeout, [&]{ return mIsReady; } );
+  }
+
+  // rethrow the exception thrown by the callable.
+  // the value is moved out like std::future, then it's valid only once and the move-only result is supported
+  T get(void)
+  {
+    wait();
+    if( mException ){
+      std::rethrow_exception( mException );
+    }
+    if constexpr ( !std::is_void_v<T> ){
+      return std::move( *mValue );
+    }
+  }
+
+  // the dropped task completes with DeadlineMissedException without onExecute()
+  virtual void onComplete(void)
+  {
+    if( this->isDeadlineMissed() && claim() ){
+      setException( std::make_exception_ptr( DeadlineMissedException() ) );
+    }
+  }
+
+  // the cancelled or dropped task completes with broken_promise, then get() and co_await don't wait forever
+  virtual void onAbandon(void)
+  {
+    if( claim() ){
+      setException( std::make_exception_ptr( std::future_error( std::future_errc::broken_promise ) ) );
+    }
+  }
+
+  void addContinuation(std::shared_ptr<ITask> pContinuation)
+  {
+    mMutex.lock();
+      bool bIsReady = mIsReady;
+      if( !bIsReady ){
+        mContinuations.push_back( pContinuation );
+      }
+    mMutex.unlock();
+
+    if( bIsReady ){
+      pContinuation->onExecute();
+    }
+  }
+};
+
+// the callable and the shared state in the single allocation
+template<typename T, typename F>
+class PackagedTask : public FutureState<T>
+{
+protected:
+  F mFunc;
+
+public:
+  PackagedTask(F&& func) : FutureState<T>(), mFunc( std::move( func ) ) {};
+  virtual ~PackagedTask(){};
+
+  virtual void onExecute(void)
+  {
+    if( !this->claim() ){
+      return;
+    }
+    try {
+      if constexpr ( std::is_void_v<T> ){
+        mFunc();
+        this->setValue( true );
+      } else {
+        this->setValue( mFunc() );
+      }
+    } catch (...) {
+      this->setException( std::current_exception() );
+    }
+  }
+};
+
+template<typename T>
+class Future
+{
+protected:
+  std::shared_ptr<FutureState<T>> mState;
+
+public:
+  Future(std::shared_ptr<FutureState<T>> pState = nullptr) : mState( pState ) {};
+  virtual ~Future(){};
+
+  bool isValid(void){ return mState != nullptr; };
+  bool isReady(void){ return mState && mState->isReady(); };
+  // call it once, the value is moved out. then() also consumes it
+  T get(void){ return mState->get(); };
+  void wait(void){ mState->wait(); };
+  // pContinuation->onExecute() runs on the thread completing this, or immediately if it's ready
+  void addContinuation(std::shared_ptr<ITask> pContinuation){ mState->addContinuation( pContinuation ); };
+
+  template<typename Rep, typename Period>
+  std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout)
+  {
+    return mState->waitFor( std::chrono::duration_cast<std::chrono::nanoseconds>( timeout ) ) ? std::future_status::ready : std::future_status::timeout;
+  }
+
+  // func(T) (or func() for void) runs on the thread completing this without occupying a thread to wait
+  // the exception of this is propagated to the returned Future
+  template<typename F>
+  auto then(F&& func)
+  {
+    std::shared_ptr<FutureState<T>> pState = mState;
+    auto continuation = [pState, func = std::forward<F>(func)]() mutable {
+      if constexpr ( std::is_void_v<T> ){
+        pState->get();
+        return func();
+      } else {
+        return func( pState->get() );
+      }
+    };
+    typedef std::invoke_result_t<decltype(continuation)&> RESULT;
+
+    std::shared_ptr<PackagedTask<RESULT, decltype(continuation)>> pContinuation = std::allocate_shared<PackagedTask<RESULT, decltype(continuation)>>( PoolAllocator<PackagedTask<RESULT, decltype(continuation)>>(), std::move( continuation ) );
+    mState->addContinuation( pContinuation );
+
+    return Future<RESULT>( pContinuation );
+  }
+};
+
+#endif /* __FUTURE_HPP__ */
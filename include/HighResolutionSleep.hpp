@@ -0,0 +1,33 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __HIGH_RESOLUTION_SLEEP_HPP__
+#define __HIGH_RESOLUTION_SLEEP_HPP__
+
+#include <chrono>
+
+// sleep helper for the sub-msec period
+class HighResolutionSleep
+{
+public:
+  // sleep until the absolute deadline by clock_nanosleep(TIMER_ABSTIME) on Linux (sleep_until on the others)
+  // and busy-wait the last spinDuration to absorb the wake up latency of the scheduler
+  static void sleepUntil(std::chrono::steady_clock::time_point deadline, std::chrono::nanoseconds spinDuration = std::chrono::nanoseconds(0));
+  // make the calling thread's timer slack minimum (Linux only)
+  static void setMinimumTimerSlack(void);
+};
+
+#endif /* __HIGH_RESOLUTION_SLEEP_HPP__ */
@@ -0,0 +1,130 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __INPLACE_TASK_HPP__
+#define __INPLACE_TASK_HPP__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// move-only type erased void() callable which keeps the callable up to CAPACITY bytes in itself without the heap allocation
+// the bigger callable falls back to the heap
+class InplaceTask
+{
+public:
+  static const size_t CAPACITY = 64;
+
+protected:
+  struct Operations
+  {
+    void (*invoke)(void* pStorage);
+    // move construct to pDst from pSrc and destroy pSrc
+    void (*relocate)(void* pDst, void* pSrc);
+    void (*destroy)(void* pStorage);
+  };
+
+  template<typename F>
+  static constexpr bool isInplace(void)
+  {
+    return sizeof(F) <= CAPACITY && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+  }
+
+  template<typename F>
+  static const Operations* getOperations(void)
+  {
+    if constexpr ( isInplace<F>() ){
+      static const Operations operations = {
+        []( void* pStorage ){ ( *static_cast<F*>( pStorage ) )(); },
+        []( void* pDst, void* pSrc ){ new( pDst ) F( std::move( *static_cast<F*>( pSrc ) ) ); static_cast<F*>( pSrc )->~F(); },
+        []( void* pStorage ){ static_cast<F*>( pStorage )->~F(); }
+      };
+      return &operations;
+    } else {
+      // the storage keeps the pointer to the callable
+      static const Operations operations = {
+        []( void* pStorage ){ ( **static_cast<F**>( pStorage ) )(); },
+        []( void* pDst, void* pSrc ){ *static_cast<F**>( pDst ) = *static_cast<F**>( pSrc ); },
+        []( void* pStorage ){ delete *static_cast<F**>( pStorage ); }
+      };
+      return &operations;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char mStorage[CAPACITY];
+  const Operations* mOperations;
+
+public:
+  InplaceTask() : mOperations( nullptr ) {};
+
+  template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceTask> && std::is_invocable_v<std::decay_t<F>&>>>
+  InplaceTask(F&& func) : mOperations( getOperations<std::decay_t<F>>() )
+  {
+    typedef std::decay_t<F> FUNC;
+    if constexpr ( isInplace<FUNC>() ){
+      new( mStorage ) FUNC( std::forward<F>( func ) );
+    } else {
+      *reinterpret_cast<FUNC**>( mStorage ) = new FUNC( std::forward<F>( func ) );
+    }
+  }
+
+  InplaceTask(InplaceTask&& task) noexcept : mOperations( task.mOperations )
+  {
+    if( mOperations ){
+      mOperations->relocate( mStorage, task.mStorage );
+      task.mOperations = nullptr;
+    }
+  }
+
+  InplaceTask& operator=(InplaceTask&& task) noexcept
+  {
+    if( this != &task ){
+      reset();
+      mOperations = task.mOperations;
+      if( mOperations ){
+        mOperations->relocate( mStorage, task.mStorage );
+        task.mOperations = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  InplaceTask(const InplaceTask&) = delete;
+  InplaceTask& operator=(const InplaceTask&) = delete;
+
+  ~InplaceTask()
+  {
+    reset();
+  }
+
+  void reset(void)
+  {
+    if( mOperations ){
+      mOperations->destroy( mStorage );
+      mOperations = nullptr;
+    }
+  }
+
+  explicit operator bool() const { return mOperations != nullptr; };
+
+  void operator()(void)
+  {
+    mOperations->invoke( mStorage );
+  }
+};
+
+#endif /* __INPLACE_TASK_HPP__ */
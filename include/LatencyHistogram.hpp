@@ -0,0 +1,63 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __LATENCY_HISTOGRAM_HPP__
+#define __LATENCY_HISTOGRAM_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// log2 bucketed histogram of the duration : record() is a few relaxed atomic operations for the single writer
+class LatencyHistogram
+{
+public:
+  // the bucket n counts [2^n, 2^(n+1)) nsec. the last one also counts the longer
+  static const int NUM_OF_BUCKETS = 48;
+
+  // the copy to aggregate and to query
+  struct Snapshot
+  {
+    uint64_t nBuckets[NUM_OF_BUCKETS];
+    uint64_t nCount;
+    uint64_t nSumNsec;
+    uint64_t nMaxNsec;
+
+    Snapshot();
+    void merge(const Snapshot& aSnapshot);
+    // the upper bound of the bucket containing the percentile (0.0 - 100.0), then it's at most 2x of the actual
+    std::chrono::nanoseconds getPercentile(double percentile) const;
+    std::chrono::nanoseconds getMean(void) const;
+    std::chrono::nanoseconds getMax(void) const { return std::chrono::nanoseconds( nMaxNsec ); };
+  };
+
+protected:
+  std::atomic<uint64_t> mBuckets[NUM_OF_BUCKETS];
+  std::atomic<uint64_t> mCount;
+  std::atomic<uint64_t> mSumNsec;
+  std::atomic<uint64_t> mMaxNsec;
+
+public:
+  LatencyHistogram();
+  virtual ~LatencyHistogram();
+
+  void record(std::chrono::nanoseconds duration);
+  // the concurrent record() may be partially counted
+  Snapshot getSnapshot(void) const;
+  void reset(void);
+};
+
+#endif /* __LATENCY_HISTOGRAM_HPP__ */
@@ -0,0 +1,70 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __LOCK_FREE_TASK_POOL_HPP__
+#define __LOCK_FREE_TASK_POOL_HPP__
+
+#include "ThreadPool.hpp"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+// bounded MPMC array queue (Dmitry Vyukov's algorithm)
+// enqueue() to the full pool yields until a consumer makes a room
+class LockFreeTaskPool : public ThreadPool::TaskPool
+{
+protected:
+  struct Cell
+  {
+    std::atomic<size_t> nSequence;
+    std::shared_ptr<ITask> pTask;
+  };
+
+  std::vector<Cell> mCells;
+  size_t mMask;
+  alignas(64) std::atomic<size_t> mEnqueuePos;
+  alignas(64) std::atomic<size_t> mDequeuePos;
+
+  // the tombstones are only touched by erase() and while any of them is effective
+  std::mutex mTombstoneMutex;
+  std::unordered_map<ITask*, size_t> mPosTombstones;
+  size_t mLastPosTombstone;
+  std::atomic<bool> mHasTombstone;
+
+protected:
+  bool tryEnqueue(std::shared_ptr<ITask>& pTask);
+  bool tryDequeue(std::shared_ptr<ITask>& pTask, size_t& nPos);
+  bool isErased(std::shared_ptr<ITask>& pTask, size_t nPos);
+  void notifyWaiter(void);
+  void notifyWaiters(size_t nNumOfTasks);
+
+public:
+  LockFreeTaskPool(size_t nCapacity = 16384);
+  virtual ~LockFreeTaskPool();
+  virtual void enqueue(std::shared_ptr<ITask> pTask);
+  virtual std::shared_ptr<ITask> dequeue(void);
+  virtual void enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks);
+  virtual size_t dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks);
+  virtual bool erase(std::shared_ptr<ITask> pTask);
+  virtual void clear(void);
+  virtual bool isEmpty(void);
+  virtual size_t getDepth(void);
+  virtual void waitForTask(std::atomic<bool>& bStopping);
+};
+
+#endif /* __LOCK_FREE_TASK_POOL_HPP__ */
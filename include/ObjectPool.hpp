@@ -0,0 +1,92 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __OBJECT_POOL_HPP__
+#define __OBJECT_POOL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// size class based free lists of the small blocks
+// each thread allocates and recycles the blocks in its own free list and exchanges the surplus as a batch via the shared depot
+class ObjectPool
+{
+public:
+  static const size_t ALIGNMENT = 16;
+  static const size_t MAX_SIZE = 512;
+  static const size_t NUM_OF_CLASSES = MAX_SIZE / ALIGNMENT;
+  // the number of blocks exchanged with the depot at once
+  static const size_t BATCH_SIZE = 64;
+  // the batches kept by the depot per size class. the surplus is returned to the system allocator
+  static const size_t DEFAULT_MAX_DEPOT_BATCHES = 32;
+
+  struct Statistics
+  {
+    uint64_t nHits;       // allocated from the pool
+    uint64_t nMisses;     // allocated from the system allocator
+    uint64_t nRecycled;   // returned to the pool
+    uint64_t nReleased;   // returned to the system allocator because the pool is full
+
+    double getHitRate(void){ return ( nHits + nMisses ) ? (double)nHits / (double)( nHits + nMisses ) : 0.0; };
+  };
+
+public:
+  static bool isPoolable(size_t nSize, size_t nAlignment){ return nSize && nSize <= MAX_SIZE && nAlignment <= ALIGNMENT; };
+  static void* allocate(size_t nSize);
+  static void deallocate(void* pBlock, size_t nSize);
+
+  // the depot's cached batches are released down to nMaxBatches immediately
+  static void setMaxDepotBatches(size_t nMaxBatches);
+  static size_t getMaxDepotBatches(void);
+
+  // the other threads' counts are reflected every BATCH_SIZE operations and at their exit
+  static Statistics getStatistics(void);
+  static void resetStatistics(void);
+};
+
+// the allocator for std::allocate_shared : the object and its control block are allocated from ObjectPool
+template<typename T>
+class PoolAllocator
+{
+public:
+  typedef T value_type;
+
+  PoolAllocator() noexcept {};
+  template<typename U> PoolAllocator(const PoolAllocator<U>&) noexcept {};
+
+  T* allocate(size_t n)
+  {
+    if( n == 1 && ObjectPool::isPoolable( sizeof(T), alignof(T) ) ){
+      return static_cast<T*>( ObjectPool::allocate( sizeof(T) ) );
+    }
+    return static_cast<T*>( ::operator new( n * sizeof(T), std::align_val_t( alignof(T) ) ) );
+  }
+
+  void deallocate(T* p, size_t n) noexcept
+  {
+    if( n == 1 && ObjectPool::isPoolable( sizeof(T), alignof(T) ) ){
+      ObjectPool::deallocate( p, sizeof(T) );
+    } else {
+      ::operator delete( p, std::align_val_t( alignof(T) ) );
+    }
+  }
+
+  template<typename U> bool operator==(const PoolAllocator<U>&) const noexcept { return true; };
+  template<typename U> bool operator!=(const PoolAllocator<U>&) const noexcept { return false; };
+};
+
+#endif /* __OBJECT_POOL_HPP__ */
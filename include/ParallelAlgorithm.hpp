@@ -0,0 +1,130 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#ifndef __PARALLEL_ALGORITHM_HPP__
+#define __PARALLEL_ALGORITHM_HPP__
+
+#include "ThreadPool.hpp"
+#include "InplaceTask.hpp"
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <condition_variable>
+
+// the shared state of parallel_for() and parallel_reduce()
+// the participants (the caller and the helper tasks on ThreadPool) take the chunks by the guided schedule :
+// the chunk is remaining / ( 2 * the participants ) and not smaller than the grain, then it gets smaller toward the end
+class ParallelLoop
+{
+protected:
+  int64_t mEnd;
+  int64_t mGrain;
+  int64_t mNumOfParticipants;
+  alignas(64) std::atomic<int64_t> mNext;
+  alignas(64) std::atomic<int64_t> mRemaining;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::exception_ptr mException;
+
+protected:
+  bool nextChunk(int64_t& nBegin, int64_t& nEnd);
+  void completeChunk(int64_t nSize);
+  // the first exception is kept and the chunks not taken yet are skipped
+  void setException(std::exception_ptr pException);
+
+public:
+  ParallelLoop(int64_t nBegin, int64_t nEnd, int64_t nGrain, int64_t nNumOfParticipants);
+  virtual ~ParallelLoop();
+
+  // body(nBegin, nEnd) for each chunk until no chunk is left
+  template<typename BODY>
+  void run(BODY& body)
+  {
+    int64_t nBegin, nEnd;
+    while( nextChunk( nBegin, nEnd ) ){
+      try {
+        body( nBegin, nEnd );
+      } catch (...) {
+        setException( std::current_exception() );
+      }
+      completeChunk( nEnd - nBegin );
+    }
+  }
+
+  // wait for the chunks taken by the others and rethrow the exception thrown by the body
+  void wait(void);
+};
+
+// run body(nBegin, nEnd) over [nBegin, nEnd) by the caller and up to the number of threads helper tasks.
+// the caller executes the chunks too, then it's safe to call from the worker of the same ThreadPool
+template<typename BODY>
+void parallel_for_range(std::shared_ptr<ThreadPool> pThreadPool, int64_t nBegin, int64_t nEnd, int64_t nGrain, BODY&& body)
+{
+  if( nBegin >= nEnd ){
+    return;
+  }
+  nGrain = std::max<int64_t>( nGrain, 1 );
+  int64_t nNumOfChunks = ( nEnd - nBegin + nGrain - 1 ) / nGrain;
+  int64_t nNumOfHelpers = pThreadPool ? std::min<int64_t>( pThreadPool->getNumOfThreads(), nNumOfChunks - 1 ) : 0;
+
+  std::shared_ptr<ParallelLoop> pLoop = std::make_shared<ParallelLoop>( nBegin, nEnd, nGrain, nNumOfHelpers + 1 );
+  if( nNumOfHelpers > 0 ){
+    // the late helper finds no chunk and doesn't touch the body after wait() returned
+    std::remove_reference_t<BODY>* pBody = &body;
+    for( int64_t i = 0; i < nNumOfHelpers; i++ ){
+      pThreadPool->addTask( InplaceTask( [pLoop, pBody](){ pLoop->run( *pBody ); } ) );
+    }
+  }
+  pLoop->run( body );
+  pLoop->wait();
+}
+
+// func(i) for each i in [begin, end)
+template<typename INDEX, typename F>
+void parallel_for(std::shared_ptr<ThreadPool> pThreadPool, INDEX begin, INDEX end, INDEX grain, F&& func)
+{
+  parallel_for_range( pThreadPool, (int64_t)begin, (int64_t)end, (int64_t)grain, [&func](int64_t nBegin, int64_t nEnd){
+    for( int64_t i = nBegin; i < nEnd; i++ ){
+      func( (INDEX)i );
+    }
+  } );
+}
+
+// func(chunkBegin, chunkEnd, identity) returns the result of the chunk and combine(T, T) merges them.
+// combine must be associative and commutative since the chunks are merged in the completion order
+template<typename INDEX, typename T, typename F, typename C>
+T parallel_reduce(std::shared_ptr<ThreadPool> pThreadPool, INDEX begin, INDEX end, INDEX grain, T identity, F&& func, C&& combine)
+{
+  std::mutex mutex;
+  T result = identity;
+
+  parallel_for_range( pThreadPool, (int64_t)begin, (int64_t)end, (int64_t)grain, [&](int64_t nBegin, int64_t nEnd){
+    T value = func( (INDEX)nBegin, (INDEX)nEnd, identity );
+    std::lock_guard<std::mutex> lock( mutex );
+    result = combine( std::move( result ), std::move( value ) );
+  } );
+
+  return result;
+}
+
+#endif /* __PARALLEL_ALGORITHM_HPP__ */
@@ -19,15 +19,19 @@
 
 #include "Task.hpp"
 #include "ThreadPool.hpp"
+#include "LatencyHistogram.hpp"
 
 #include <vector>
 #include <mutex>
 #include <map>
+#include <chrono>
+#include <condition_variable>
 
 class IPeriodicTaskManager
 {
 public:
   virtual void scheduleRepeat(std::shared_ptr<Task> pTask, int nPeriodMSec) = 0;
+  virtual void scheduleRepeat(std::shared_ptr<Task> pTask, std::chrono::nanoseconds period) = 0;
   virtual void cancelScheduleRepeat(std::shared_ptr<Task> pTask) = 0;
   virtual void execute(void) = 0;
   virtual void terminate(void) = 0;
@@ -35,18 +39,107 @@ public:
 
 class PeriodicTask : public Task
 {
-protected:
-  int mPeriodicMsec;
+public:
+  // how to handle the ticks whose deadline passed while the previous tick was executing
+  enum class OverrunPolicy
+  {
+    SKIP,       // skip the missed ticks and keep the phase
+    CATCH_UP,   // execute every missed tick back to back
+    COALESCE    // execute the missed ticks once immediately and restart the period from there
+  };
+
+  // per period
+  struct Statistics
+  {
+    uint64_t nTicks;
+    // the ticks whose deadline passed before the previous tick finished
+    uint64_t nOverruns;
+    // the ticks dropped by SKIP or merged by COALESCE
+    uint64_t nSkippedTicks;
+    // the actual start - the target deadline of the tick
+    LatencyHistogram::Snapshot startJitter;
+    // all of the tasks of the tick
+    LatencyHistogram::Snapshot executionTime;
+
+    Statistics() : nTicks( 0 ), nOverruns( 0 ), nSkippedTicks( 0 ){};
+  };
+
+  // per task
+  struct TaskStatistics
+  {
+    uint64_t nExecutions;
+    // the executions longer than the period
+    uint64_t nOverruns;
+    LatencyHistogram::Snapshot executionTime;
+
+    TaskStatistics() : nExecutions( 0 ), nOverruns( 0 ){};
+  };
+
+  // called on the periodic thread when a tick overruns, then it should return quickly
+  class IOverrunListener
+  {
+  public:
+    virtual void onOverrun(std::chrono::nanoseconds period, std::chrono::nanoseconds lateness, uint64_t nSkippedTicks) = 0;
+  };
 
-  std::vector<std::shared_ptr<Task>> mTasks;
+protected:
+  struct TaskEntry
+  {
+    std::shared_ptr<Task> pTask;
+    std::shared_ptr<LatencyHistogram> pExecutionTime;
+    std::shared_ptr<std::atomic<uint64_t>> pNumOfOverruns;
+  };
+
+  // counts down the tasks dispatched to the ThreadPool in a tick
+  struct CompletionBarrier
+  {
+    std::mutex mutex;
+    std::condition_variable condition;
+    int nNumOfPendingTasks;
+  };
+
+  std::chrono::nanoseconds mPeriod;
+  OverrunPolicy mOverrunPolicy;
+  // busy-wait the last this duration of each period to reduce the jitter
+  std::chrono::nanoseconds mSpinDuration;
+
+  std::vector<TaskEntry> mTasks;
+  std::vector<TaskEntry> mExecutingTasks;
   std::mutex mMutexTasks;
 
+  // the tasks of a tick are executed in parallel on this if specified
+  std::shared_ptr<ThreadPool> mThreadPool;
+  std::shared_ptr<CompletionBarrier> mBarrier;
+
+  // written by the periodic thread only
+  std::atomic<uint64_t> mNumOfTicks;
+  std::atomic<uint64_t> mNumOfOverruns;
+  std::atomic<uint64_t> mNumOfSkippedTicks;
+  LatencyHistogram mStartJitter;
+  LatencyHistogram mExecutionTime;
+  // guarded by mMutexTasks
+  std::shared_ptr<IOverrunListener> mOverrunListener;
+
+protected:
+  void executeTasks(void);
+  void executeTasksInParallel(void);
+  void executeTask(const TaskEntry& aTask);
+  void onOverrun(std::chrono::nanoseconds lateness, uint64_t nSkippedTicks);
+
 public:
-  PeriodicTask(int nPeriodMSec): mPeriodicMsec(nPeriodMSec){};
+  PeriodicTask(int nPeriodMSec, OverrunPolicy overrunPolicy = OverrunPolicy::COALESCE): PeriodicTask(std::chrono::milliseconds(nPeriodMSec), overrunPolicy){};
+  PeriodicTask(std::chrono::nanoseconds period, OverrunPolicy overrunPolicy = OverrunPolicy::COALESCE, std::chrono::nanoseconds spinDuration = std::chrono::nanoseconds(0), std::shared_ptr<ThreadPool> pThreadPool = nullptr): mPeriod(period), mOverrunPolicy(overrunPolicy), mSpinDuration(spinDuration), mThreadPool(pThreadPool), mNumOfTicks(0), mNumOfOverruns(0), mNumOfSkippedTicks(0){};
   virtual ~PeriodicTask(){};
 
   virtual void addTask(std::shared_ptr<Task> pTask);
-  virtual void cancelTask(std::shared_ptr<Task> pTask);
+  // true if pTask was registered
+  virtual bool cancelTask(std::shared_ptr<Task> pTask);
+  virtual bool isEmpty(void);
+
+  Statistics getStatistics(void);
+  // return false if pTask isn't registered
+  bool getTaskStatistics(std::shared_ptr<Task> pTask, TaskStatistics& statistics);
+  void setOverrunListener(std::shared_ptr<IOverrunListener> pListener);
 
   virtual void onExecute(void);
   virtual void cancel(void);
@@ -56,15 +149,28 @@ public:
 class PeriodicTaskPool : public ThreadPool::TaskPool
 {
 protected:
-  int mPeriodicMsec;
+  std::chrono::nanoseconds mPeriod;
+  PeriodicTask::OverrunPolicy mOverrunPolicy;
+  std::chrono::nanoseconds mSpinDuration;
+  std::shared_ptr<ThreadPool> mThreadPool;
+  // replaced under mTaskMutex. isEmpty() reads it with or without mTaskMutex, e.g. in waitForTask()
+  std::atomic<std::shared_ptr<PeriodicTask>> mPeriodicTask;
+  std::shared_ptr<PeriodicTask::IOverrunListener> mOverrunListener;
 
 public:
-  PeriodicTaskPool(int nPeriodMSec);
+  PeriodicTaskPool(std::chrono::nanoseconds period, PeriodicTask::OverrunPolicy overrunPolicy = PeriodicTask::OverrunPolicy::COALESCE, std::chrono::nanoseconds spinDuration = std::chrono::nanoseconds(0), std::shared_ptr<ThreadPool> pThreadPool = nullptr);
   virtual ~PeriodicTaskPool();
   virtual void enqueue(std::shared_ptr<ITask> pTask);
   virtual std::shared_ptr<ITask> dequeue(void);
-  virtual void erase(std::shared_ptr<ITask> pTask);
+  virtual void enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks);
+  virtual size_t dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks);
+  virtual bool erase(std::shared_ptr<ITask> pTask);
   virtual void clear(void);
+  virtual bool isEmpty(void);
+
+  PeriodicTask::Statistics getStatistics(void);
+  bool getTaskStatistics(std::shared_ptr<Task> pTask, PeriodicTask::TaskStatistics& statistics);
+  void setOverrunListener(std::shared_ptr<PeriodicTask::IOverrunListener> pListener);
 
 protected:
   std::shared_ptr<PeriodicTask> getPeriodicTask(void);
@@ -73,20 +179,38 @@ protected:
 class PeriodicTaskManager : public IPeriodicTaskManager
 {
 protected:
-  std::map<int, std::shared_ptr<ThreadPool::ThreadExector>> mThreads;
-  std::map<int, std::shared_ptr<ThreadPool::TaskPool>> mTaskPool;
+  std::map<std::chrono::nanoseconds, std::shared_ptr<ThreadPool::ThreadExector>> mThreads;
+  std::map<std::chrono::nanoseconds, std::shared_ptr<PeriodicTaskPool>> mTaskPool;
+  // the pools stopped by terminate() : their statistics are kept until the next scheduleRepeat()
+  std::map<std::chrono::nanoseconds, std::shared_ptr<PeriodicTaskPool>> mTerminatedTaskPool;
   std::mutex mMutex;
+  PeriodicTask::OverrunPolicy mOverrunPolicy;
+  std::chrono::nanoseconds mSpinDuration;
+  std::shared_ptr<ThreadPool> mThreadPool;
+  std::shared_ptr<PeriodicTask::IOverrunListener> mOverrunListener;
+  // kept while the period has no task
+  std::map<std::chrono::nanoseconds, std::vector<int>> mAffinities;
 
 protected:
-  bool isEmpty(int nPeriodMSec);
+  bool isEmpty(std::chrono::nanoseconds period);
 
 public:
-  PeriodicTaskManager();
+  // pThreadPool : the tasks sharing a period are dispatched to it in parallel and each tick waits for all of them
+  PeriodicTaskManager(PeriodicTask::OverrunPolicy overrunPolicy = PeriodicTask::OverrunPolicy::COALESCE, std::chrono::nanoseconds spinDuration = std::chrono::nanoseconds(0), std::shared_ptr<ThreadPool> pThreadPool = nullptr);
   virtual ~PeriodicTaskManager();
 
   virtual void scheduleRepeat(std::shared_ptr<Task> pTask, int nPeriodMSec);
+  virtual void scheduleRepeat(std::shared_ptr<Task> pTask, std::chrono::nanoseconds period);
   virtual void cancelScheduleRepeat(std::shared_ptr<Task> pTask);
 
+  // the statistics are kept while the period has any task, and after terminate() for the final snapshot
+  std::map<std::chrono::nanoseconds, PeriodicTask::Statistics> getStatistics(void);
+  // merged if pTask is scheduled at the several periods
+  PeriodicTask::TaskStatistics getTaskStatistics(std::shared_ptr<Task> pTask);
+  void setOverrunListener(std::shared_ptr<PeriodicTask::IOverrunListener> pListener);
+  // pin the thread of the period to cpus, the empty cpus unpins it. return false if it's not supported or failed to apply
+  bool setAffinity(std::chrono::nanoseconds period, const std::vector<int>& cpus);
+
   virtual void execute(void);
   virtual void terminate(void);
 };
@@ -0,0 +1,65 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __PRIORITY_TASK_POOL_HPP__
+#define __PRIORITY_TASK_POOL_HPP__
+
+#include "ThreadPool.hpp"
+
+#include <deque>
+#include <chrono>
+#include <atomic>
+
+// bucket queue by ITask::getPriority() : FIFO in the same priority and the higher priority is dequeued first
+// aging : the waiting task gains one priority level per mAgingInterval, then the low priority task isn't starved
+class PriorityTaskPool : public ThreadPool::TaskPool
+{
+protected:
+  struct AgingTask : public QueuedTask
+  {
+    std::chrono::steady_clock::time_point enqueueTime;
+  };
+
+  std::deque<AgingTask> mPriorityTasks[ITask::NUM_OF_PRIORITIES];
+  std::atomic<size_t> mNumOfTasks;
+  // InplaceTask is dequeued before them only while no task above PRIORITY_NORMAL is queued
+  std::atomic<size_t> mNumOfHighPriorityTasks;
+  std::chrono::nanoseconds mAgingInterval;
+
+protected:
+  static int getQueueIndex(std::shared_ptr<ITask>& pTask);
+  // the queue whose front has the highest priority including the aging. -1 if empty
+  int getNextQueue(void);
+  // they're called with mTaskMutex locked. popTask() returns false if empty, and pTask is null if it's erased
+  void pushTask(std::shared_ptr<ITask>& pTask, std::chrono::steady_clock::time_point now);
+  bool popTask(std::shared_ptr<ITask>& pTask);
+  virtual void clearConsumedTombstones(void);
+
+public:
+  PriorityTaskPool(std::chrono::nanoseconds agingInterval = std::chrono::milliseconds(100));
+  virtual ~PriorityTaskPool();
+  virtual void enqueue(std::shared_ptr<ITask> pTask);
+  virtual std::shared_ptr<ITask> dequeue(void);
+  virtual void enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks);
+  virtual size_t dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks);
+  virtual bool erase(std::shared_ptr<ITask> pTask);
+  virtual void clear(void);
+  virtual bool isEmpty(void);
+  virtual bool dequeueInplace(InplaceTask& task);
+  virtual size_t getDepth(void);
+};
+
+#endif /* __PRIORITY_TASK_POOL_HPP__ */
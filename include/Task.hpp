@@ -19,12 +19,55 @@
 
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
+
+class Task;
 
 class ITask
 {
+public:
+  // used by PriorityTaskPool and TaskManager. the larger is executed earlier
+  static const int PRIORITY_LOW = 0;
+  static const int PRIORITY_NORMAL = 1;
+  static const int PRIORITY_HIGH = 2;
+  static const int PRIORITY_CRITICAL = 3;
+  static const int NUM_OF_PRIORITIES = 4;
+
+protected:
+  // set by Task : the scheduler sees the cancellable task with the lifecycle flags without RTTI
+  Task* mTask = nullptr;
+  // set by ThreadPool::addTask() while its metrics are enabled
+  std::chrono::steady_clock::time_point mEnqueueTime;
+  int mPriority = PRIORITY_NORMAL;
+  // used by DeadlineTaskPool. the epoch means no deadline
+  std::chrono::steady_clock::time_point mDeadline;
+  std::atomic<bool> mDeadlineMissed = false;
+  // the number of the entries in the work-stealing deques
+  std::atomic<int> mNumOfLocalEntries = 0;
+
 public:
   virtual void onExecute(void) = 0;
   virtual void onComplete(void){};
+  // called instead of onExecute() when the queued task is cancelled or dropped by the pool
+  virtual void onAbandon(void){};
+  Task* getTask(void){ return mTask; };
+  void setEnqueueTime(std::chrono::steady_clock::time_point enqueueTime){ mEnqueueTime = enqueueTime; };
+  std::chrono::steady_clock::time_point getEnqueueTime(void){ return mEnqueueTime; };
+  // set before adding the task, the queued task isn't reordered
+  void setPriority(int nPriority){ mPriority = nPriority; };
+  int getPriority(void){ return mPriority; };
+  void setDeadline(std::chrono::steady_clock::time_point deadline){ mDeadline = deadline; mDeadlineMissed = false; };
+  std::chrono::steady_clock::time_point getDeadline(void){ return mDeadline; };
+  bool hasDeadline(void){ return mDeadline.time_since_epoch().count() != 0; };
+  // set before onComplete() of the task dropped or started after its deadline
+  void setDeadlineMissed(void){ mDeadlineMissed = true; };
+  bool isDeadlineMissed(void){ return mDeadlineMissed; };
+  // used by WorkStealingGroup. return the number after the update
+  int addLocalEntries(int nDelta){ return mNumOfLocalEntries.fetch_add( nDelta ) + nDelta; };
+  int getNumOfLocalEntries(void){ return mNumOfLocalEntries.load(); };
 };
 
 class Task : public ITask, public std::enable_shared_from_this<Task>
@@ -39,17 +82,38 @@ public:
 protected:
   std::atomic<bool> mIsRunning;
   std::atomic<bool> mStopRunning;
+  // set by the dispatcher like TimingWheel, and cleared when the dispatched execution finishes or is abandoned
+  std::atomic<bool> mIsInFlight;
+
+  // completion signal : execute() notifies only when somebody waits
+  std::mutex mMutexCompletion;
+  std::condition_variable mCompletionCondition;
+  std::atomic<int> mNumOfWaiters;
 
 public:
   Task(void);
   virtual ~Task(void);
   void execute(void);
   static void executeThreadFunc(std::shared_ptr<ITask> pTask, std::shared_ptr<ITaskNotifier> pNotifier);
+  // the replacement of dynamic_pointer_cast<Task> : nullptr if pTask isn't Task
+  static std::shared_ptr<Task> toTask(std::shared_ptr<ITask> pTask){ return ( pTask && pTask->getTask() ) ? std::shared_ptr<Task>( pTask, pTask->getTask() ) : nullptr; };
   virtual void cancel(void);
   bool isRunning(void){ return mIsRunning; };
+  // false if the previous dispatch is still queued or running
+  bool tryMarkInFlight(void){ return !mIsInFlight.exchange( true ); };
+  // the dropped task ends like the executed one : the in-flight flag is released and the waiters are notified.
+  // the running one does it by itself
+  virtual void onAbandon(void);
+
+  // wait until the running task exits. return immediately if it's not running
+  void waitForCompletion(void);
+  // return false if the task is still running after the timeout
+  bool waitForCompletion(std::chrono::nanoseconds timeout);
+  static bool waitForCompletion(const std::vector<std::shared_ptr<Task>>& tasks, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
 
 protected:
   void _execute(std::shared_ptr<ITaskNotifier> pNotifier);
+  void notifyCompletion(void);
 };
 
 #endif /* __TASK_HPP__ */
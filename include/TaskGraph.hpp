@@ -0,0 +1,107 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#ifndef __TASK_GRAPH_HPP__
+#define __TASK_GRAPH_HPP__
+
+#include "Task.hpp"
+#include "ThreadPool.hpp"
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <exception>
+#include <condition_variable>
+
+// DAG of the tasks : the node is added to ThreadPool when its last predecessor completes.
+// the graph can be run again without the reallocation. don't modify it while it's running.
+// if ThreadPool cancels or drops a node, the rest of the graph completes without running the tasks
+class TaskGraph
+{
+public:
+  class Node : public ITask
+  {
+    friend class TaskGraph;
+
+  protected:
+    TaskGraph* mGraph;
+    size_t mIndex;
+    std::shared_ptr<ITask> mTask;
+    std::vector<size_t> mSuccessors;
+    int mNumOfPredecessors;
+    std::atomic<int> mNumOfPendingPredecessors;
+    // won by the first of onExecute(), onAbandon() or the inline run of the predecessor per run
+    std::atomic<bool> mIsClaimed;
+
+  protected:
+    bool claim(void);
+    void executeTask(void);
+    // run this and the successors which become ready on the caller's thread
+    void execute(void);
+
+  public:
+    Node(TaskGraph* pGraph, size_t nIndex, std::shared_ptr<ITask> pTask);
+    virtual ~Node();
+
+    // pPredecessor completes before this
+    void addPredecessor(std::shared_ptr<Node> pPredecessor);
+    std::shared_ptr<ITask> getTask(void){ return mTask; };
+    // the ready successor runs on the same thread and the others are added to ThreadPool
+    virtual void onExecute(void);
+    virtual void onAbandon(void);
+  };
+
+protected:
+  std::vector<std::shared_ptr<Node>> mNodes;
+  // cached by validate() until the graph is modified
+  std::vector<std::shared_ptr<ITask>> mRootNodes;
+  bool mIsValidated;
+  bool mIsAcyclic;
+
+  std::shared_ptr<ThreadPool> mThreadPool;
+  std::atomic<size_t> mNumOfRemainingNodes;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mIsRunning;
+  // the first exception of the node's task, or broken_promise if it's abandoned. rethrown by wait()
+  std::exception_ptr mException;
+  std::atomic<bool> mIsAbandoned;
+
+protected:
+  bool validate(void);
+  void onNodeComplete(void);
+  void setException(std::exception_ptr pException);
+  void waitForCompletion(void);
+
+public:
+  TaskGraph();
+  // wait for the running graph
+  virtual ~TaskGraph();
+
+  std::shared_ptr<Node> addNode(std::shared_ptr<ITask> pTask);
+  void clear(void);
+  size_t getNumOfNodes(void){ return mNodes.size(); };
+
+  // add the nodes without the predecessor to pThreadPool. false if it's running or it has a cycle
+  bool run(std::shared_ptr<ThreadPool> pThreadPool);
+  // rethrow the exception of the run
+  void wait(void);
+  bool isRunning(void);
+};
+
+#endif /* __TASK_GRAPH_HPP__ */
@@ -24,6 +24,7 @@
 #include <memory>
 
 #include "Task.hpp"
+#include "ThreadPool.hpp"
 
 class ITaskManager
 {
@@ -42,11 +43,13 @@ public:
 class TaskManager : public ITaskManager, public Task::ITaskNotifier, public std::enable_shared_from_this<TaskManager>
 {
 public:
-  TaskManager(int nMaxThread = 4);
+  // pThreadPool : run the tasks on the shared ThreadPool instead of own mMaxThread workers
+  TaskManager(int nMaxThread = 4, std::shared_ptr<ThreadPool> pThreadPool = nullptr);
   virtual ~TaskManager();
 
 public:
   virtual void addTask(std::shared_ptr<Task> pTask);
+  // useJoin is kept for the compatibility : the worker is reused, then both wait until the task stops
   virtual void cancelTask(std::shared_ptr<Task> pTask, bool useJoin);
   virtual void cancelTask(std::shared_ptr<Task> pTask){ cancelTask( pTask, false ); };
 
@@ -56,18 +59,59 @@ public:
   virtual bool isRemainingTasks(void);
   virtual void finalize(void);
 
+  // the metrics of the ThreadPool (shared with the other users if it's given)
+  void enableMetrics(bool bEnabled = true);
+  ThreadPool::Metrics getMetrics(void);
+
   // for task
 public:
   virtual void onTaskCompletion(std::shared_ptr<ITask> pTask);
 
+protected:
+  // runs the task on the ThreadPool's worker and notifies the completion to the TaskManager if it's still alive
+  class TaskRunner : public Task
+  {
+  public:
+    enum State
+    {
+      QUEUED,
+      RUNNING,
+      DONE,
+      CANCELLED
+    };
+
+  protected:
+    std::shared_ptr<Task> mTask;
+    std::weak_ptr<TaskManager> mTaskManager;
+    std::atomic<int> mState;
+
+  public:
+    TaskRunner(std::shared_ptr<Task> pTask, std::shared_ptr<TaskManager> pTaskManager);
+    virtual ~TaskRunner();
+    virtual void onExecute(void);
+    // the queued runner is just skipped, the running one cancels the task. use waitForCompletion() to wait for its exit
+    virtual void cancel(void);
+    // dropped by the pool before it runs, then the slot is released
+    virtual void onAbandon(void);
+    bool isActive(void){ return mState == QUEUED || isRunning(); };
+  };
+
+protected:
+  void dispatchTasks(void);
+  // release the slot of the runner dropped by the pool. the next task is dispatched only if it's dropped by the deadline,
+  // the pool terminated would drop it again
+  void onTaskAbandoned(std::shared_ptr<Task> pTask, bool bDispatchNext);
+
 protected:
   int mMaxThread;
   std::atomic<bool> mStopping;
+  std::shared_ptr<ThreadPool> mThreadPool;
+  bool mIsOwnThreadPool;
 
   std::vector<std::shared_ptr<Task>> mTasks;
-  std::map<std::shared_ptr<Task>, std::shared_ptr<std::thread>> mThreads;
+  std::map<std::shared_ptr<Task>, std::shared_ptr<TaskRunner>> mRunners;
   std::mutex mMutexTasks;
-  std::mutex mMutexThreads;
+  std::mutex mMutexRunners;
 };
 
 #endif /* __TASK_MANAGER_HPP__ */
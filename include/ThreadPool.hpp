@@ -18,61 +18,289 @@
 #define __THREAD_POOL_HPP__
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
 
 #include "Task.hpp"
+#include "Future.hpp"
+#include "Coroutine.hpp"
+#include "LatencyHistogram.hpp"
+#include "InplaceTask.hpp"
+#include "ObjectPool.hpp"
+#include "WorkStealing.hpp"
 
 class ThreadPool
 {
 public:
+  // the snapshot aggregated from the workers by getMetrics()
+  struct Metrics
+  {
+    int nNumOfThreads;
+    uint64_t nExecutedTasks;
+    std::vector<uint64_t> executedTasksPerWorker;
+    // the busy and the idle times are measured while the metrics are enabled
+    std::chrono::nanoseconds busyTime;
+    std::chrono::nanoseconds idleTime;
+    size_t nQueueDepth;
+    size_t nMaxQueueDepth;
+    // counted by DeadlineTaskPool
+    uint64_t nDeadlineMisses;
+    // enqueue to start. InplaceTask isn't counted
+    LatencyHistogram::Snapshot waitLatency;
+    LatencyHistogram::Snapshot executionLatency;
+
+    Metrics() : nNumOfThreads( 0 ), nExecutedTasks( 0 ), busyTime( 0 ), idleTime( 0 ), nQueueDepth( 0 ), nMaxQueueDepth( 0 ), nDeadlineMisses( 0 ){};
+    double getUtilization(void){ return ( busyTime + idleTime ).count() ? (double)busyTime.count() / (double)( busyTime + idleTime ).count() : 0.0; };
+  };
+
   class TaskPool
   {
   protected:
-    std::vector<std::shared_ptr<ITask>> mTasks;
+    struct QueuedTask
+    {
+      std::shared_ptr<ITask> pTask;
+      uint64_t nSequence;
+    };
+
+    std::deque<QueuedTask> mTasks;
+    uint64_t mSequence;
+    // erase() tombstones the task: its entries enqueued before the sequence are skipped by dequeue()
+    std::unordered_map<ITask*, uint64_t> mTombstones;
+    uint64_t mLastTombstone;
     std::mutex mTaskMutex;
+    std::condition_variable mTaskCondition;
+    std::atomic<int> mNumOfWaiters;
+
+    // the by-value queue of InplaceTask : the ring buffer doesn't allocate in the steady state
+    std::vector<InplaceTask> mInplaceTasks;
+    size_t mInplaceHead;
+    std::atomic<size_t> mNumOfInplaceTasks;
+
+    // the high-water mark of getDepth()
+    std::atomic<size_t> mMaxDepth;
+
+    // the tasks in the work-stealing deques of the workers parking on this. the parked worker wakes up to steal them
+    std::atomic<int64_t> mNumOfLocalTasks;
+
+  protected:
+    void notifyWaiter(void);
+    // wake up min(nNumOfTasks, the parked workers)
+    void notifyWaiters(size_t nNumOfTasks);
+    bool isErased(const QueuedTask& aTask);
+    virtual void clearConsumedTombstones(void);
+    void updateMaxDepth(size_t nDepth);
 
   public:
     TaskPool();
     virtual ~TaskPool();
     virtual void enqueue(std::shared_ptr<ITask> pTask);
     virtual std::shared_ptr<ITask> dequeue(void);
-    virtual void erase(std::shared_ptr<ITask> pTask);
+    // in the single critical section. return the number of the tasks appended to tasks
+    virtual void enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks);
+    virtual size_t dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks);
+    // true if a queued entry of pTask is removed or tombstoned, then the caller abandons it
+    virtual bool erase(std::shared_ptr<ITask> pTask);
+    // the queued tasks are abandoned. it's also done by the destructor
     virtual void clear(void);
     virtual bool isEmpty(void);
+    bool hasWaiter(void){ return mNumOfWaiters > 0; };
+
+    // InplaceTask can't be erased
+    virtual void enqueueInplace(InplaceTask&& task);
+    virtual bool dequeueInplace(InplaceTask& task);
+    bool hasInplaceTask(void){ return mNumOfInplaceTasks > 0; };
+
+    // the number of the queued tasks including the erased ones not dequeued yet
+    virtual size_t getDepth(void);
+    size_t getMaxDepth(void){ return mMaxDepth.load( std::memory_order_relaxed ); };
+    void resetMaxDepth(void){ mMaxDepth.store( 0, std::memory_order_relaxed ); };
+    virtual uint64_t getNumOfDeadlineMisses(void){ return 0; };
+
+    // called after the task is pushed to / taken from the work-stealing deque
+    void onLocalTaskPushed(void);
+    void onLocalTaskTaken(void){ mNumOfLocalTasks.fetch_sub( 1, std::memory_order_relaxed ); };
+
+    // park the caller until a task is enqueued (or pushed to the work-stealing deque) or bStopping is set
+    virtual void waitForTask(std::atomic<bool>& bStopping);
+    virtual void wakeUpAll(void);
+
+    // call onAbandon() of the tasks dropped without the execution. call it out of the lock
+    static void abandonTasks(std::vector<std::shared_ptr<ITask>>& tasks);
   };
 
   class ThreadExector : public std::enable_shared_from_this<ThreadExector>
   {
   protected:
     std::shared_ptr<TaskPool> mTaskPool;
+    // written by the worker and read by terminate() and cancelTaskIfRunning() under mRunningTaskMutex
     std::shared_ptr<ITask> mCurrentRunningTask;
+    std::mutex mRunningTaskMutex;
+    InplaceTask mCurrentInplaceTask;
     std::shared_ptr<std::thread> mThread;
     std::atomic<bool> mStopping;
+    int mSpinCount;
+    // alternate InplaceTask and the shared_ptr task, then neither of them starves the other
+    bool mInplaceFirst;
+    // the empty means no pinning
+    std::vector<int> mCpus;
+    std::mutex mAffinityMutex;
+
+    // the tasks taken by dequeueBatch() and not executed yet. mBatchMutex is contended only by cancelTaskIfRunning()
+    std::vector<std::shared_ptr<ITask>> mBatchTasks;
+    size_t mBatchHead;
+    size_t mBatchSize;
+    std::mutex mBatchMutex;
+
+    // for the work-stealing mode
+    std::shared_ptr<WorkStealingGroup> mWorkStealing;
+    std::shared_ptr<WorkStealingDeque> mLocalTasks;
+    int mIndex;
+    uint32_t mRandom;
+
+    // written only by the worker and read by collectMetrics(). mNumOfExecutedTasks is released after the others
+    std::atomic<bool> mMetricsEnabled;
+    std::atomic<uint64_t> mNumOfExecutedTasks;
+    std::atomic<int64_t> mBusyTimeNsec;
+    std::atomic<int64_t> mMetricsStartTimeNsec;
+    LatencyHistogram mWaitLatency;
+    LatencyHistogram mExecutionLatency;
 
   public:
-    ThreadExector(std::shared_ptr<TaskPool> pTaskPool);
+    ThreadExector(std::shared_ptr<TaskPool> pTaskPool, std::shared_ptr<WorkStealingGroup> pWorkStealing = nullptr, int nIndex = 0);
     virtual ~ThreadExector();
     void execute(void);
     void terminate(void);
-    void cancelTaskIfRunning(std::shared_ptr<ITask> pTask);
+    // true if pTask is removed from the batch taken but not executed yet. the running task is just cancelled
+    bool cancelTaskIfRunning(std::shared_ptr<ITask> pTask);
+    // push the task to own deque if this belongs to the pWorkStealing
+    bool addLocalTask(std::shared_ptr<WorkStealingGroup> pWorkStealing, std::shared_ptr<ITask> pTask);
+    // take up to nBatchSize tasks from the TaskPool at once. it's ignored in the work-stealing mode
+    void setBatchSize(size_t nBatchSize){ mBatchSize = nBatchSize ? nBatchSize : 1; };
+    // pin the worker to cpus. it's applied when the worker starts, or immediately if it's running.
+    // return false if it's not supported or failed to apply
+    bool setAffinity(const std::vector<int>& cpus);
+
+    void enableMetrics(bool bEnabled);
+    // add this worker's counters to metrics without stopping the worker
+    void collectMetrics(Metrics& metrics);
+    void resetMetrics(void);
+
+    // return the ThreadExector running the caller's thread or nullptr
+    static ThreadExector* getCurrentExector(void);
 
   protected:
     static void _execute( std::shared_ptr<ThreadExector> pThis );
+    bool applyAffinity(std::thread::native_handle_type thread);
     void onExecute(void);
+    std::shared_ptr<ITask> getNextTask(void);
+    void setCurrentRunningTask(std::shared_ptr<ITask> pTask);
+    std::shared_ptr<ITask> getCurrentRunningTask(void);
+    std::shared_ptr<ITask> getNextBatchTask(void);
+    bool executeInplaceTask(void);
+    bool executeNextTask(void);
+    void executeTask(void);
+    void recordExecution(bool bMeasured, std::chrono::steady_clock::time_point startTime);
+  };
+
+  enum AffinityPolicy
+  {
+    // the OS migrates the workers freely
+    AFFINITY_NONE,
+    // the worker i is pinned to cpus[ i % cpus.size() ]
+    AFFINITY_ROUND_ROBIN,
+    // every worker runs on any of cpus
+    AFFINITY_CPUSET,
+    // the worker i is pinned to workerCpus[i]
+    AFFINITY_EXPLICIT
+  };
+
+  struct Config
+  {
+    int nNumOfThreads;
+    bool bWorkStealing;
+    // TaskPool is used if nullptr. it's ignored with bWorkStealing
+    std::shared_ptr<TaskPool> pTaskPool;
+    size_t nDequeueBatchSize;
+    AffinityPolicy affinityPolicy;
+    // the empty cpus means getAvailableCpus()
+    std::vector<int> cpus;
+    std::vector<std::vector<int>> workerCpus;
+
+    Config(int nNumOfThreads = std::thread::hardware_concurrency()) : nNumOfThreads( nNumOfThreads ), bWorkStealing( false ), nDequeueBatchSize( 1 ), affinityPolicy( AFFINITY_NONE ) {};
   };
 
 protected:
   int mMaxThreads;
   std::vector<std::shared_ptr<ThreadExector>> mThreads;
   std::shared_ptr<TaskPool> mTaskPool;
+  std::shared_ptr<WorkStealingGroup> mWorkStealing;
+  std::atomic<bool> mMetricsEnabled;
 
 public:
   ThreadPool( int nNumOfThreads = std::thread::hardware_concurrency() );
+  ThreadPool( int nNumOfThreads, std::shared_ptr<TaskPool> pTaskPool );
+  // bWorkStealing : the task added from the worker goes to the worker's own deque and the idle worker steals it
+  ThreadPool( int nNumOfThreads, bool bWorkStealing );
+  ThreadPool( const Config& config );
   virtual ~ThreadPool();
 
+  // the task added after terminate() is abandoned
   void addTask(std::shared_ptr<ITask> pTask);
+  // set the deadline for DeadlineTaskPool and add the task
+  void addTask(std::shared_ptr<ITask> pTask, std::chrono::steady_clock::time_point deadline);
+  // queue the small callable by value without the heap allocation. it can't be cancelled
+  void addTask(InplaceTask&& task);
+  // enqueue the tasks by one lock and wake up the parked workers as needed
+  void addTasks(const std::vector<std::shared_ptr<ITask>>& tasks);
+  // each worker takes up to nBatchSize tasks at once. set it before execute()
+  void setDequeueBatchSize(size_t nBatchSize);
   void canceTask(std::shared_ptr<ITask> pTask);
+  int getNumOfThreads(void){ return mMaxThreads; };
+  // the CPUs which the calling thread is allowed to run on
+  static std::vector<int> getAvailableCpus(void);
+
+  // allocate the task with its control block from ObjectPool instead of std::make_shared
+  template<typename T, typename... Args>
+  static std::shared_ptr<T> makeTask(Args&&... args)
+  {
+    return std::allocate_shared<T>( PoolAllocator<T>(), std::forward<Args>(args)... );
+  }
+
+  // run func(args...) and get the result by the Future. the callable is stored in the Future's state without LambdaTask
+  template<typename F, typename... Args>
+  auto submit(F&& func, Args&&... args)
+  {
+    auto bound = [func = std::forward<F>(func), ...args = std::forward<Args>(args)]() mutable {
+      return std::invoke( func, args... );
+    };
+    typedef std::invoke_result_t<decltype(bound)&> RESULT;
+
+    std::shared_ptr<PackagedTask<RESULT, decltype(bound)>> pTask = makeTask<PackagedTask<RESULT, decltype(bound)>>( std::move( bound ) );
+    addTask( pTask );
+
+    return Future<RESULT>( pTask );
+  }
+
+#if ASYNC_TASK_COROUTINE
+  // co_await pool.schedule() : the coroutine is resumed on the worker
+  struct ScheduleAwaiter
+  {
+    ThreadPool* mThreadPool;
+    bool await_ready(void) noexcept { return false; };
+    void await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> handle){ mThreadPool->addTask( InplaceTask( [handle](){ handle.resume(); } ) ); };
+    void await_resume(void) noexcept {};
+  };
+  ScheduleAwaiter schedule(void){ return ScheduleAwaiter{ this }; };
+#endif /* ASYNC_TASK_COROUTINE */
+
+  // measure the busy time and the latencies. the executed task count is always counted
+  void enableMetrics(bool bEnabled = true);
+  Metrics getMetrics(void);
+  void resetMetrics(void);
 
   void execute(void);
   void terminate(void);
@@ -18,6 +18,7 @@
 #define __TIMER_HPP__
 
 #include "Task.hpp"
+#include "TimingWheel.hpp"
 #include "PeriodicTask.hpp"
 #include "ThreadPool.hpp"
 #include <mutex>
@@ -30,48 +31,43 @@
 class Timer : public Task
 {
 protected:
-  class DelayedTask : public Task
-  {
-  protected:
-    std::shared_ptr<Task> mTask;
-    int mDelayMsec;
-  public:
-    DelayedTask(std::shared_ptr<Task> pTask, int nDelayMsec) : mTask( pTask ), mDelayMsec( nDelayMsec ){};
-    virtual ~DelayedTask(){};
-    virtual void onExecute(void){
-      if( mTask ){
-        std::this_thread::sleep_for( std::chrono::milliseconds( mDelayMsec ) );
-        if( mIsRunning && !mStopRunning ){
-          mTask->onExecute();
-        }
-      }
-    }
-    virtual void cancel(void){
-      if( mTask ){
-        mTask->cancel();
-      }
-    }
-  };
-
-protected:
-  inline static std::shared_ptr<IPeriodicTaskManager> mPeriodicTaskManager;
+  inline static std::shared_ptr<TimingWheel> mTimingWheel;
   inline static std::shared_ptr<ThreadPool> mThreadPool;
+  inline static std::shared_ptr<PeriodicTaskManager> mPeriodicTaskManager;
   inline static std::atomic<int> mTaskManRefCounter = 0;
-  int mDelayMsec;
+  // guards the shared ones above against the concurrent creation and the teardown by the last Timer
+  inline static std::mutex mSharedMutex;
+  std::chrono::nanoseconds mDelay;
   bool mRepeat;
 
 protected:
-  std::shared_ptr<IPeriodicTaskManager> getTaskManager(void);
+  std::shared_ptr<TimingWheel> getTimingWheel(void);
   std::shared_ptr<ThreadPool> getThreadPool(void);
+  std::shared_ptr<PeriodicTaskManager> getPeriodicTaskManager(void);
+  // the repeated timer shorter than the wheel's tick runs on the dedicated periodic thread
+  bool isHighResolution(void);
 
 public:
   Timer(int nDelayMsec, bool bRepeat = true);
+  Timer(std::chrono::nanoseconds delay, bool bRepeat = true);
   virtual ~Timer();
 
   virtual void schedule(void);
   virtual void cancelSchedule(void);
 
   virtual void onExecute(void) = 0;
+
+#if ASYNC_TASK_COROUTINE
+  // co_await Timer::after( delay ) : the coroutine is resumed on the Timer's ThreadPool without blocking a thread
+  struct DelayAwaiter
+  {
+    std::chrono::nanoseconds mDelay;
+    bool await_ready(void) noexcept { return mDelay.count() <= 0; };
+    void await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> handle);
+    void await_resume(void) noexcept {};
+  };
+  static DelayAwaiter after(std::chrono::nanoseconds delay){ return DelayAwaiter{ delay }; };
+#endif /* ASYNC_TASK_COROUTINE */
 };
 
 
@@ -82,6 +78,7 @@ protected:
 
 public:
   LambdaTimer(TASK_LAMBDA lambda, int nDelayMsec, bool bRepeat = true);
+  LambdaTimer(TASK_LAMBDA lambda, std::chrono::nanoseconds delay, bool bRepeat = true);
   virtual ~LambdaTimer(void);
 
   virtual void onExecute(void);
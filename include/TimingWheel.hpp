@@ -0,0 +1,93 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __TIMING_WHEEL_HPP__
+#define __TIMING_WHEEL_HPP__
+
+#include "Task.hpp"
+#include "ThreadPool.hpp"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+// hierarchical timing wheel : one thread keeps every timer and dispatches the expired task to the ThreadPool
+class TimingWheel : public std::enable_shared_from_this<TimingWheel>
+{
+protected:
+  static const int NUM_OF_LEVELS = 4;
+  static const int SLOT_BITS = 8;
+  static const int NUM_OF_SLOTS = 1 << SLOT_BITS;
+
+  struct TimerEntry
+  {
+    std::shared_ptr<Task> pTask;
+    uint64_t nDeadline;
+    uint64_t nPeriod;
+    int nLevel;
+    int nSlot;
+  };
+  typedef std::list<TimerEntry> SLOT;
+
+  SLOT mSlots[NUM_OF_LEVELS][NUM_OF_SLOTS];
+  std::unordered_map<Task*, SLOT::iterator> mEntries;
+
+  std::shared_ptr<ThreadPool> mThreadPool;
+  std::chrono::steady_clock::time_point mStartTime;
+  std::chrono::microseconds mTick;
+  uint64_t mCurrentTick;
+
+  std::shared_ptr<std::thread> mThread;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mStopping;
+
+protected:
+  uint64_t getNowTick(void);
+  uint64_t getDeadlineTick(std::chrono::nanoseconds delay);
+  uint64_t toTicks(std::chrono::nanoseconds duration);
+  // move the entry at it from pSlot to the slot for its deadline
+  void place(SLOT* pSlot, SLOT::iterator it);
+  void cascade(int nLevel);
+  void advance(std::vector<TimerEntry>& expiredTasks);
+  std::chrono::steady_clock::time_point getNextWakeUpTime(void);
+  void dispatch(std::vector<TimerEntry>& expiredTasks);
+  static void _execute(std::shared_ptr<TimingWheel> pThis);
+  void onExecute(void);
+
+public:
+  static constexpr std::chrono::microseconds DEFAULT_TICK = std::chrono::milliseconds(1);
+
+  TimingWheel(std::shared_ptr<ThreadPool> pThreadPool, std::chrono::microseconds tick = DEFAULT_TICK);
+  virtual ~TimingWheel();
+
+  // nPeriodMsec = 0 for the one shot
+  void schedule(std::shared_ptr<Task> pTask, int nDelayMsec, int nPeriodMsec = 0);
+  // the delay and the period are rounded up to the tick
+  void schedule(std::shared_ptr<Task> pTask, std::chrono::nanoseconds delay, std::chrono::nanoseconds period = std::chrono::nanoseconds(0));
+  void cancel(std::shared_ptr<Task> pTask);
+  bool isScheduled(std::shared_ptr<Task> pTask);
+  std::chrono::microseconds getTick(void);
+
+  void execute(void);
+  void terminate(void);
+};
+
+#endif /* __TIMING_WHEEL_HPP__ */
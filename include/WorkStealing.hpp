@@ -0,0 +1,92 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __WORK_STEALING_HPP__
+#define __WORK_STEALING_HPP__
+
+#include "Task.hpp"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+
+// Chase-Lev deque (Le et al. for the weak memory model) with the fixed capacity
+// push() and pop() are only for the owner thread, steal() is for any thread
+class WorkStealingDeque
+{
+protected:
+  // the slot owns the task in place without the allocation per push.
+  // the taker moves it out after winning the index and then clears bIsBusy, the owner doesn't reuse the slot until then
+  struct Slot
+  {
+    std::atomic<bool> bIsBusy = false;
+    std::shared_ptr<ITask> pTask;
+  };
+
+  std::vector<Slot> mBuffer;
+  int64_t mMask;
+  alignas(64) std::atomic<int64_t> mTop;
+  alignas(64) std::atomic<int64_t> mBottom;
+
+protected:
+  // called only by the winner of nIndex
+  std::shared_ptr<ITask> take(int64_t nIndex);
+
+public:
+  WorkStealingDeque(size_t nCapacity = 1024);
+  virtual ~WorkStealingDeque();
+
+  // return false if full or the slot is still being taken
+  bool push(std::shared_ptr<ITask> pTask);
+  std::shared_ptr<ITask> pop(void);
+  std::shared_ptr<ITask> steal(void);
+  bool isEmpty(void);
+};
+
+// the set of the per-thread deques shared by the ThreadExectors of the work-stealing ThreadPool
+class WorkStealingGroup
+{
+protected:
+  std::vector<std::shared_ptr<WorkStealingDeque>> mDeques;
+
+  // the deque can't erase the task, then the cancelled task is skipped when it's taken.
+  // the task is marked only while it's in any deque and the mark is dropped with its last entry
+  std::mutex mMutexCancelled;
+  std::unordered_set<ITask*> mCancelledTasks;
+  std::atomic<bool> mHasCancelled;
+
+public:
+  WorkStealingGroup(int nNumOfThreads);
+  virtual ~WorkStealingGroup();
+
+  std::shared_ptr<WorkStealingDeque> getDeque(int nIndex);
+  // try the victims from the random position except the thief itself
+  std::shared_ptr<ITask> steal(int nThief, uint32_t& nRandom);
+
+  // true if any entry of pTask is skipped by the mark
+  bool cancel(std::shared_ptr<ITask> pTask);
+  void resume(std::shared_ptr<ITask> pTask);
+  // push to the deque with counting the entries of pTask
+  bool push(std::shared_ptr<WorkStealingDeque> pDeque, std::shared_ptr<ITask> pTask);
+  // called for the task taken from any deque. true if it's cancelled
+  bool isCancelled(std::shared_ptr<ITask> pTask);
+  bool hasCancelledTask(void){ return mHasCancelled; };
+  // abandon the tasks left in the deques after the workers stop
+  void clear(void);
+};
+
+#endif /* __WORK_STEALING_HPP__ */
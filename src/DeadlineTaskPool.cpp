@@ -0,0 +1,184 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "DeadlineTaskPool.hpp"
+#include <algorithm>
+
+DeadlineTaskPool::DeadlineTaskPool(bool bDropMissed) : mNumOfTasks( 0 ), mDropMissed( bDropMissed ), mNumOfDeadlineMisses( 0 )
+{
+}
+
+DeadlineTaskPool::~DeadlineTaskPool()
+{
+  clear();
+}
+
+bool DeadlineTaskPool::isLater(const DeadlineTask& aTask1, const DeadlineTask& aTask2)
+{
+  // the comparator of the max heap, then the earliest deadline is at the top
+  return ( aTask1.deadline != aTask2.deadline ) ? ( aTask1.deadline > aTask2.deadline ) : ( aTask1.nSequence > aTask2.nSequence );
+}
+
+void DeadlineTaskPool::pushTask(std::shared_ptr<ITask>& pTask)
+{
+  DeadlineTask aTask;
+  aTask.pTask = pTask;
+  aTask.deadline = pTask->hasDeadline() ? pTask->getDeadline() : std::chrono::steady_clock::time_point::max();
+  aTask.nSequence = mSequence++;
+  mHeap.push_back( std::move( aTask ) );
+  std::push_heap( mHeap.begin(), mHeap.end(), isLater );
+  mNumOfTasks++;
+}
+
+void DeadlineTaskPool::enqueue(std::shared_ptr<ITask> pTask)
+{
+  if( pTask ){
+    mTaskMutex.lock();
+      pushTask( pTask );
+      updateMaxDepth( mNumOfTasks + mNumOfInplaceTasks );
+    mTaskMutex.unlock();
+    notifyWaiter();
+  }
+}
+
+void DeadlineTaskPool::enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  size_t nNumOfTasks = 0;
+
+  mTaskMutex.lock();
+    mHeap.reserve( mHeap.size() + tasks.size() );
+    for( auto pTask : tasks ){
+      if( pTask ){
+        pushTask( pTask );
+        nNumOfTasks++;
+      }
+    }
+    updateMaxDepth( mNumOfTasks + mNumOfInplaceTasks );
+  mTaskMutex.unlock();
+  notifyWaiters( nNumOfTasks );
+}
+
+bool DeadlineTaskPool::popTask(std::shared_ptr<ITask>& pTask, std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<ITask>>& droppedTasks)
+{
+  if( mHeap.empty() ){
+    return false;
+  }
+
+  std::pop_heap( mHeap.begin(), mHeap.end(), isLater );
+  DeadlineTask& aTask = mHeap.back();
+  if( aTask.deadline < now ){
+    mNumOfDeadlineMisses.fetch_add( 1, std::memory_order_relaxed );
+    aTask.pTask->setDeadlineMissed();
+    if( mDropMissed ){
+      droppedTasks.push_back( std::move( aTask.pTask ) );
+    } else {
+      pTask = std::move( aTask.pTask );
+    }
+  } else {
+    pTask = std::move( aTask.pTask );
+  }
+  mHeap.pop_back();
+  mNumOfTasks--;
+
+  return true;
+}
+
+std::shared_ptr<ITask> DeadlineTaskPool::dequeue(void)
+{
+  std::shared_ptr<ITask> result;
+  std::vector<std::shared_ptr<ITask>> droppedTasks;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  mTaskMutex.lock();
+    while( !result && popTask( result, now, droppedTasks ) );
+  mTaskMutex.unlock();
+
+  // notify the drop out of the lock, onComplete() may add the next task.
+  // then it ends like the task dropped by terminate()
+  for( auto& pTask : droppedTasks ){
+    pTask->onComplete();
+    pTask->onAbandon();
+  }
+
+  return result;
+}
+
+size_t DeadlineTaskPool::dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks)
+{
+  size_t result = 0;
+  std::shared_ptr<ITask> pTask;
+  std::vector<std::shared_ptr<ITask>> droppedTasks;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  mTaskMutex.lock();
+    while( result < nMaxTasks && popTask( pTask, now, droppedTasks ) ){
+      if( pTask ){
+        tasks.push_back( std::move( pTask ) );
+        result++;
+      }
+    }
+  mTaskMutex.unlock();
+
+  for( auto& pDroppedTask : droppedTasks ){
+    pDroppedTask->onComplete();
+    pDroppedTask->onAbandon();
+  }
+
+  return result;
+}
+
+bool DeadlineTaskPool::erase(std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  // the heap isn't ordered by the sequence and the tombstone would live until it's empty, then remove the entries
+  mTaskMutex.lock();
+    if( pTask && mNumOfTasks ){
+      result = std::erase_if( mHeap, [&pTask](const DeadlineTask& aTask){ return aTask.pTask == pTask; } ) > 0;
+      if( result ){
+        std::make_heap( mHeap.begin(), mHeap.end(), isLater );
+        mNumOfTasks = mHeap.size();
+      }
+    }
+  mTaskMutex.unlock();
+
+  return result;
+}
+
+void DeadlineTaskPool::clear(void)
+{
+  std::vector<std::shared_ptr<ITask>> abandonedTasks;
+
+  mTaskMutex.lock();
+    for( auto& aTask : mHeap ){
+      abandonedTasks.push_back( std::move( aTask.pTask ) );
+    }
+    mHeap.clear();
+    mNumOfTasks = 0;
+  mTaskMutex.unlock();
+  abandonTasks( abandonedTasks );
+  TaskPool::clear();
+}
+
+bool DeadlineTaskPool::isEmpty(void)
+{
+  return !mNumOfTasks && !mNumOfInplaceTasks;
+}
+
+size_t DeadlineTaskPool::getDepth(void)
+{
+  return mNumOfTasks + mNumOfInplaceTasks;
+}
@@ -0,0 +1,58 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "HighResolutionSleep.hpp"
+#include <thread>
+
+#if defined(__linux__)
+#include <time.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#endif
+
+void HighResolutionSleep::sleepUntil(std::chrono::steady_clock::time_point deadline, std::chrono::nanoseconds spinDuration)
+{
+  std::chrono::steady_clock::time_point wakeUpTime = deadline - spinDuration;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  if( wakeUpTime > now ){
+#if defined(__linux__)
+    // steady_clock's epoch isn't guaranteed to be CLOCK_MONOTONIC's, then convert via the remaining time
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    int64_t nWakeUpNsec = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec + std::chrono::duration_cast<std::chrono::nanoseconds>( wakeUpTime - now ).count();
+    ts.tv_sec = nWakeUpNsec / 1000000000LL;
+    ts.tv_nsec = nWakeUpNsec % 1000000000LL;
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) == EINTR );
+#else
+    std::this_thread::sleep_until( wakeUpTime );
+#endif
+  }
+
+  if( spinDuration.count() > 0 ){
+    while( std::chrono::steady_clock::now() < deadline ){
+      std::this_thread::yield();
+    }
+  }
+}
+
+void HighResolutionSleep::setMinimumTimerSlack(void)
+{
+#if defined(__linux__)
+  // the default 50usec slack is too large for the sub-msec period
+  prctl( PR_SET_TIMERSLACK, 1UL, 0, 0, 0 );
+#endif
+}
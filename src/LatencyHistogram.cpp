@@ -0,0 +1,109 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "LatencyHistogram.hpp"
+#include <bit>
+
+static int getBucket(uint64_t nNsec)
+{
+  int result = nNsec ? std::bit_width( nNsec ) - 1 : 0;
+  return ( result < LatencyHistogram::NUM_OF_BUCKETS ) ? result : ( LatencyHistogram::NUM_OF_BUCKETS - 1 );
+}
+
+LatencyHistogram::Snapshot::Snapshot() : nBuckets{ 0 }, nCount( 0 ), nSumNsec( 0 ), nMaxNsec( 0 )
+{
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot& aSnapshot)
+{
+  for( int i = 0; i < NUM_OF_BUCKETS; i++ ){
+    nBuckets[i] += aSnapshot.nBuckets[i];
+  }
+  nCount += aSnapshot.nCount;
+  nSumNsec += aSnapshot.nSumNsec;
+  if( aSnapshot.nMaxNsec > nMaxNsec ){
+    nMaxNsec = aSnapshot.nMaxNsec;
+  }
+}
+
+std::chrono::nanoseconds LatencyHistogram::Snapshot::getPercentile(double percentile) const
+{
+  uint64_t nTotal = 0;
+  for( int i = 0; i < NUM_OF_BUCKETS; i++ ){
+    nTotal += nBuckets[i];
+  }
+
+  uint64_t nTarget = (uint64_t)( (double)nTotal * percentile / 100.0 );
+  uint64_t nAccumulated = 0;
+  for( int i = 0; i < NUM_OF_BUCKETS; i++ ){
+    nAccumulated += nBuckets[i];
+    if( nBuckets[i] && nAccumulated >= nTarget ){
+      uint64_t nUpperBound = ( 2ull << i ) - 1;
+      return std::chrono::nanoseconds( ( nUpperBound < nMaxNsec ) ? nUpperBound : nMaxNsec );
+    }
+  }
+
+  return std::chrono::nanoseconds( 0 );
+}
+
+std::chrono::nanoseconds LatencyHistogram::Snapshot::getMean(void) const
+{
+  return std::chrono::nanoseconds( nCount ? ( nSumNsec / nCount ) : 0 );
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration)
+{
+  uint64_t nNsec = ( duration.count() > 0 ) ? duration.count() : 0;
+
+  mBuckets[ getBucket( nNsec ) ].fetch_add( 1, std::memory_order_relaxed );
+  mCount.fetch_add( 1, std::memory_order_relaxed );
+  mSumNsec.fetch_add( nNsec, std::memory_order_relaxed );
+  uint64_t nMax = mMaxNsec.load( std::memory_order_relaxed );
+  while( nNsec > nMax && !mMaxNsec.compare_exchange_weak( nMax, nNsec, std::memory_order_relaxed ) );
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::getSnapshot(void) const
+{
+  Snapshot result;
+
+  for( int i = 0; i < NUM_OF_BUCKETS; i++ ){
+    result.nBuckets[i] = mBuckets[i].load( std::memory_order_relaxed );
+  }
+  result.nCount = mCount.load( std::memory_order_relaxed );
+  result.nSumNsec = mSumNsec.load( std::memory_order_relaxed );
+  result.nMaxNsec = mMaxNsec.load( std::memory_order_relaxed );
+
+  return result;
+}
+
+void LatencyHistogram::reset(void)
+{
+  for( int i = 0; i < NUM_OF_BUCKETS; i++ ){
+    mBuckets[i].store( 0, std::memory_order_relaxed );
+  }
+  mCount.store( 0, std::memory_order_relaxed );
+  mSumNsec.store( 0, std::memory_order_relaxed );
+  mMaxNsec.store( 0, std::memory_order_relaxed );
+}
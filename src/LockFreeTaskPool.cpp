@@ -0,0 +1,244 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "LockFreeTaskPool.hpp"
+#include <cstdint>
+
+static size_t getPowerOfTwo(size_t nCapacity)
+{
+  size_t result = 2;
+  while( result < nCapacity ){
+    result = result << 1;
+  }
+  return result;
+}
+
+LockFreeTaskPool::LockFreeTaskPool(size_t nCapacity) : mCells( getPowerOfTwo( nCapacity ) ), mEnqueuePos( 0 ), mDequeuePos( 0 ), mLastPosTombstone( 0 ), mHasTombstone( false )
+{
+  mMask = mCells.size() - 1;
+  for( size_t i = 0; i < mCells.size(); i++ ){
+    mCells[i].nSequence.store( i, std::memory_order_relaxed );
+  }
+}
+
+LockFreeTaskPool::~LockFreeTaskPool()
+{
+  clear();
+}
+
+bool LockFreeTaskPool::tryEnqueue(std::shared_ptr<ITask>& pTask)
+{
+  Cell* pCell = nullptr;
+  size_t nPos = mEnqueuePos.load( std::memory_order_relaxed );
+
+  while( true ){
+    pCell = &mCells[ nPos & mMask ];
+    size_t nSequence = pCell->nSequence.load( std::memory_order_acquire );
+    intptr_t diff = (intptr_t)nSequence - (intptr_t)nPos;
+    if( diff == 0 ){
+      if( mEnqueuePos.compare_exchange_weak( nPos, nPos + 1, std::memory_order_relaxed ) ){
+        break;
+      }
+    } else if( diff < 0 ){
+      // full
+      return false;
+    } else {
+      nPos = mEnqueuePos.load( std::memory_order_relaxed );
+    }
+  }
+
+  pCell->pTask = std::move( pTask );
+  pCell->nSequence.store( nPos + 1, std::memory_order_release );
+
+  return true;
+}
+
+bool LockFreeTaskPool::tryDequeue(std::shared_ptr<ITask>& pTask, size_t& nPos)
+{
+  Cell* pCell = nullptr;
+  nPos = mDequeuePos.load( std::memory_order_relaxed );
+
+  while( true ){
+    pCell = &mCells[ nPos & mMask ];
+    size_t nSequence = pCell->nSequence.load( std::memory_order_acquire );
+    intptr_t diff = (intptr_t)nSequence - (intptr_t)( nPos + 1 );
+    if( diff == 0 ){
+      if( mDequeuePos.compare_exchange_weak( nPos, nPos + 1, std::memory_order_relaxed ) ){
+        break;
+      }
+    } else if( diff < 0 ){
+      // empty
+      return false;
+    } else {
+      nPos = mDequeuePos.load( std::memory_order_relaxed );
+    }
+  }
+
+  pTask = std::move( pCell->pTask );
+  std::shared_ptr<ITask> pErasedTask;
+  if( mHasTombstone.load( std::memory_order_acquire ) && isErased( pTask, nPos ) ){
+    pErasedTask = std::move( pTask );
+  }
+  // release the cell after the tombstone check, see isErased()
+  pCell->nSequence.store( nPos + mMask + 1, std::memory_order_release );
+  if( pErasedTask ){
+    pErasedTask->onAbandon();
+  }
+
+  return true;
+}
+
+bool LockFreeTaskPool::isErased(std::shared_ptr<ITask>& pTask, size_t nPos)
+{
+  bool result = false;
+
+  mTombstoneMutex.lock();
+    auto it = mPosTombstones.find( pTask.get() );
+    result = ( it != mPosTombstones.end() ) && ( nPos < it->second );
+    // the producer can't reach the position +capacity until every consumer holding the older position releases its cell.
+    // then nobody can see the older position than the last tombstone any more.
+    if( nPos >= mLastPosTombstone + mMask + 1 ){
+      mPosTombstones.clear();
+      mHasTombstone = false;
+    }
+  mTombstoneMutex.unlock();
+
+  return result;
+}
+
+void LockFreeTaskPool::enqueue(std::shared_ptr<ITask> pTask)
+{
+  while( !tryEnqueue( pTask ) ){
+    std::this_thread::yield();
+  }
+  updateMaxDepth( getDepth() );
+  notifyWaiter();
+}
+
+std::shared_ptr<ITask> LockFreeTaskPool::dequeue(void)
+{
+  std::shared_ptr<ITask> result;
+  size_t nPos;
+
+  while( !result && tryDequeue( result, nPos ) );
+
+  return result;
+}
+
+void LockFreeTaskPool::enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  size_t nNumOfTasks = 0;
+
+  for( auto pTask : tasks ){
+    if( pTask ){
+      while( !tryEnqueue( pTask ) ){
+        std::this_thread::yield();
+      }
+      nNumOfTasks++;
+    }
+  }
+  updateMaxDepth( getDepth() );
+  notifyWaiters( nNumOfTasks );
+}
+
+size_t LockFreeTaskPool::dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks)
+{
+  size_t result = 0;
+  std::shared_ptr<ITask> pTask;
+  size_t nPos;
+
+  while( result < nMaxTasks && tryDequeue( pTask, nPos ) ){
+    if( pTask ){
+      tasks.push_back( std::move( pTask ) );
+      result++;
+    }
+  }
+
+  return result;
+}
+
+bool LockFreeTaskPool::erase(std::shared_ptr<ITask> pTask)
+{
+  // the cells can't be inspected without racing with the consumers, then the consumer abandons the skipped entry instead
+  if( pTask ){
+    mTombstoneMutex.lock();
+      size_t nPos = mEnqueuePos.load();
+      mPosTombstones.insert_or_assign( pTask.get(), nPos );
+      mLastPosTombstone = nPos;
+      mHasTombstone = true;
+    mTombstoneMutex.unlock();
+  }
+
+  return false;
+}
+
+void LockFreeTaskPool::clear(void)
+{
+  std::shared_ptr<ITask> pTask;
+  size_t nPos;
+
+  while( tryDequeue( pTask, nPos ) ){
+    if( pTask ){
+      pTask->onAbandon();
+      pTask.reset();
+    }
+  }
+  TaskPool::clear();
+}
+
+bool LockFreeTaskPool::isEmpty(void)
+{
+  return mDequeuePos.load() >= mEnqueuePos.load() && !mNumOfInplaceTasks;
+}
+
+size_t LockFreeTaskPool::getDepth(void)
+{
+  // read the dequeue position first, it never passes the enqueue position
+  size_t nDequeuePos = mDequeuePos.load();
+  size_t nEnqueuePos = mEnqueuePos.load();
+  return ( nEnqueuePos - nDequeuePos ) + mNumOfInplaceTasks;
+}
+
+void LockFreeTaskPool::notifyWaiter(void)
+{
+  // pairs with the fence in waitForTask(): either the waiter sees the task or we see the waiter
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if( mNumOfWaiters ){
+    // enqueue() doesn't take mTaskMutex, then serialize with the waiter's predicate check here
+    mTaskMutex.lock();
+    mTaskMutex.unlock();
+    mTaskCondition.notify_one();
+  }
+}
+
+void LockFreeTaskPool::notifyWaiters(size_t nNumOfTasks)
+{
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if( mNumOfWaiters ){
+    mTaskMutex.lock();
+    mTaskMutex.unlock();
+    TaskPool::notifyWaiters( nNumOfTasks );
+  }
+}
+
+void LockFreeTaskPool::waitForTask(std::atomic<bool>& bStopping)
+{
+  std::unique_lock<std::mutex> lock( mTaskMutex );
+  mNumOfWaiters++;
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  mTaskCondition.wait( lock, [&]{ return bStopping || !isEmpty(); } );
+  mNumOfWaiters--;
+}
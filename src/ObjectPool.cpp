@@ -0,0 +1,246 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ObjectPool.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+struct FreeBlock
+{
+  FreeBlock* pNext;
+};
+
+// the surplus batches shared by the threads
+struct Depot
+{
+  std::mutex mutex;
+  std::vector<FreeBlock*> batches;
+};
+
+static Depot gDepots[ ObjectPool::NUM_OF_CLASSES ];
+static std::atomic<size_t> gMaxDepotBatches = ObjectPool::DEFAULT_MAX_DEPOT_BATCHES;
+static std::atomic<uint64_t> gHits = 0;
+static std::atomic<uint64_t> gMisses = 0;
+static std::atomic<uint64_t> gRecycled = 0;
+static std::atomic<uint64_t> gReleased = 0;
+
+static size_t getClassIndex(size_t nSize)
+{
+  return ( nSize + ObjectPool::ALIGNMENT - 1 ) / ObjectPool::ALIGNMENT - 1;
+}
+
+static size_t getBlockSize(size_t nClassIndex)
+{
+  return ( nClassIndex + 1 ) * ObjectPool::ALIGNMENT;
+}
+
+static void releaseBlocks(FreeBlock* pBlock, size_t nClassIndex)
+{
+  while( pBlock ){
+    FreeBlock* pNext = pBlock->pNext;
+    ::operator delete( pBlock, getBlockSize( nClassIndex ) );
+    pBlock = pNext;
+  }
+}
+
+class LocalPool
+{
+protected:
+  struct FreeList
+  {
+    FreeBlock* pHead = nullptr;
+    size_t nCount = 0;
+  };
+
+  FreeList mFreeLists[ ObjectPool::NUM_OF_CLASSES ];
+  uint64_t mHits = 0;
+  uint64_t mMisses = 0;
+  uint64_t mRecycled = 0;
+  uint64_t mReleased = 0;
+
+public:
+  enum State
+  {
+    NOT_CONSTRUCTED,
+    ALIVE,
+    DESTRUCTED
+  };
+  // trivially destructible, then it's valid even after gLocalPool's destruction
+  static thread_local State state;
+
+  LocalPool(){ state = ALIVE; };
+  ~LocalPool()
+  {
+    state = DESTRUCTED;
+    for( size_t i = 0; i < ObjectPool::NUM_OF_CLASSES; i++ ){
+      releaseBlocks( mFreeLists[i].pHead, i );
+    }
+    flushStatistics();
+  }
+
+  void flushStatistics(void)
+  {
+    gHits.fetch_add( mHits, std::memory_order_relaxed );
+    gMisses.fetch_add( mMisses, std::memory_order_relaxed );
+    gRecycled.fetch_add( mRecycled, std::memory_order_relaxed );
+    gReleased.fetch_add( mReleased, std::memory_order_relaxed );
+    mHits = mMisses = mRecycled = mReleased = 0;
+  }
+
+  void countUp(uint64_t& nCounter)
+  {
+    nCounter++;
+    if( !( ( mHits + mMisses + mRecycled + mReleased ) % ObjectPool::BATCH_SIZE ) ){
+      flushStatistics();
+    }
+  }
+
+  void* allocate(size_t nClassIndex)
+  {
+    FreeList& freeList = mFreeLists[ nClassIndex ];
+
+    if( !freeList.pHead ){
+      // refill a batch from the depot
+      Depot& depot = gDepots[ nClassIndex ];
+      depot.mutex.lock();
+        if( !depot.batches.empty() ){
+          freeList.pHead = depot.batches.back();
+          freeList.nCount = ObjectPool::BATCH_SIZE;
+          depot.batches.pop_back();
+        }
+      depot.mutex.unlock();
+    }
+
+    FreeBlock* pBlock = freeList.pHead;
+    if( pBlock ){
+      freeList.pHead = pBlock->pNext;
+      freeList.nCount--;
+      countUp( mHits );
+    } else {
+      pBlock = static_cast<FreeBlock*>( ::operator new( getBlockSize( nClassIndex ) ) );
+      countUp( mMisses );
+    }
+
+    return pBlock;
+  }
+
+  void deallocate(void* pPtr, size_t nClassIndex)
+  {
+    FreeList& freeList = mFreeLists[ nClassIndex ];
+    FreeBlock* pBlock = static_cast<FreeBlock*>( pPtr );
+    pBlock->pNext = freeList.pHead;
+    freeList.pHead = pBlock;
+    freeList.nCount++;
+    countUp( mRecycled );
+
+    if( freeList.nCount >= ObjectPool::BATCH_SIZE * 2 ){
+      // hand over a batch to the depot, then the consumer thread's surplus reaches the producer thread
+      FreeBlock* pBatch = freeList.pHead;
+      FreeBlock* pLast = pBatch;
+      for( size_t i = 1; i < ObjectPool::BATCH_SIZE; i++ ){
+        pLast = pLast->pNext;
+      }
+      freeList.pHead = pLast->pNext;
+      freeList.nCount -= ObjectPool::BATCH_SIZE;
+      pLast->pNext = nullptr;
+
+      Depot& depot = gDepots[ nClassIndex ];
+      depot.mutex.lock();
+        bool bIsFull = depot.batches.size() >= gMaxDepotBatches.load( std::memory_order_relaxed );
+        if( !bIsFull ){
+          depot.batches.push_back( pBatch );
+        }
+      depot.mutex.unlock();
+
+      if( bIsFull ){
+        releaseBlocks( pBatch, nClassIndex );
+        mReleased += ObjectPool::BATCH_SIZE;
+      }
+    }
+  }
+};
+
+thread_local LocalPool::State LocalPool::state = LocalPool::NOT_CONSTRUCTED;
+static thread_local LocalPool gLocalPool;
+
+void* ObjectPool::allocate(size_t nSize)
+{
+  if( LocalPool::state == LocalPool::DESTRUCTED ){
+    // allocated while this thread is exiting
+    return ::operator new( getBlockSize( getClassIndex( nSize ) ) );
+  }
+  return gLocalPool.allocate( getClassIndex( nSize ) );
+}
+
+void ObjectPool::deallocate(void* pBlock, size_t nSize)
+{
+  if( pBlock ){
+    if( LocalPool::state == LocalPool::DESTRUCTED ){
+      // released after this thread's pool is destructed
+      ::operator delete( pBlock, getBlockSize( getClassIndex( nSize ) ) );
+    } else {
+      gLocalPool.deallocate( pBlock, getClassIndex( nSize ) );
+    }
+  }
+}
+
+void ObjectPool::setMaxDepotBatches(size_t nMaxBatches)
+{
+  gMaxDepotBatches = nMaxBatches;
+
+  for( size_t i = 0; i < NUM_OF_CLASSES; i++ ){
+    std::vector<FreeBlock*> surplusBatches;
+    Depot& depot = gDepots[i];
+    depot.mutex.lock();
+      while( depot.batches.size() > nMaxBatches ){
+        surplusBatches.push_back( depot.batches.back() );
+        depot.batches.pop_back();
+      }
+    depot.mutex.unlock();
+
+    // release out of the lock
+    for( auto pBatch : surplusBatches ){
+      releaseBlocks( pBatch, i );
+    }
+    gReleased.fetch_add( surplusBatches.size() * BATCH_SIZE, std::memory_order_relaxed );
+  }
+}
+
+size_t ObjectPool::getMaxDepotBatches(void)
+{
+  return gMaxDepotBatches.load();
+}
+
+ObjectPool::Statistics ObjectPool::getStatistics(void)
+{
+  if( LocalPool::state == LocalPool::ALIVE ){
+    gLocalPool.flushStatistics();
+  }
+  return { gHits.load(), gMisses.load(), gRecycled.load(), gReleased.load() };
+}
+
+void ObjectPool::resetStatistics(void)
+{
+  if( LocalPool::state == LocalPool::ALIVE ){
+    gLocalPool.flushStatistics();
+  }
+  gHits = 0;
+  gMisses = 0;
+  gRecycled = 0;
+  gReleased = 0;
+}
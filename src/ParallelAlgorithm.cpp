@@ -0,0 +1,79 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include "ParallelAlgorithm.hpp"
+#include <thread>
+
+ParallelLoop::ParallelLoop(int64_t nBegin, int64_t nEnd, int64_t nGrain, int64_t nNumOfParticipants) : mEnd( nEnd ), mGrain( nGrain ), mNumOfParticipants( nNumOfParticipants ), mNext( nBegin ), mRemaining( nEnd - nBegin )
+{
+}
+
+ParallelLoop::~ParallelLoop()
+{
+}
+
+bool ParallelLoop::nextChunk(int64_t& nBegin, int64_t& nEnd)
+{
+  int64_t nNext = mNext.load( std::memory_order_relaxed );
+  while( nNext < mEnd ){
+    int64_t nChunk = std::max( mGrain, ( mEnd - nNext ) / ( 2 * mNumOfParticipants ) );
+    int64_t nChunkEnd = std::min( mEnd, nNext + nChunk );
+    if( mNext.compare_exchange_weak( nNext, nChunkEnd, std::memory_order_relaxed ) ){
+      nBegin = nNext;
+      nEnd = nChunkEnd;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParallelLoop::completeChunk(int64_t nSize)
+{
+  if( mRemaining.fetch_sub( nSize, std::memory_order_acq_rel ) == nSize ){
+    // serialize with the predicate check in wait()
+    mMutex.lock();
+    mMutex.unlock();
+    mCondition.notify_all();
+  }
+}
+
+void ParallelLoop::setException(std::exception_ptr pException)
+{
+  mMutex.lock();
+    if( !mException ){
+      mException = pException;
+    }
+  mMutex.unlock();
+
+  int64_t nNext = mNext.exchange( mEnd, std::memory_order_relaxed );
+  if( nNext < mEnd ){
+    completeChunk( mEnd - nNext );
+  }
+}
+
+void ParallelLoop::wait(void)
+{
+  // the others' last chunks are usually short, then spin a little before sleeping
+  for( int i = 0; i < 64 && mRemaining.load( std::memory_order_acquire ) > 0; i++ ){
+    std::this_thread::yield();
+  }
+  std::unique_lock<std::mutex> lock( mMutex );
+  mCondition.wait( lock, [&]{ return mRemaining.load( std::memory_order_acquire ) <= 0; } );
+  if( mException ){
+    std::rethrow_exception( mException );
+  }
+}
@@ -15,57 +15,215 @@
 */
 
 #include "PeriodicTask.hpp"
-#include <iostream>
+#include "HighResolutionSleep.hpp"
+#include "LambdaTask.hpp"
 
 void PeriodicTask::addTask(std::shared_ptr<Task> pTask)
 {
   mMutexTasks.lock();
-    mTasks.push_back( pTask );
+    mTasks.push_back( { pTask, std::make_shared<LatencyHistogram>(), std::make_shared<std::atomic<uint64_t>>( 0 ) } );
   mMutexTasks.unlock();
 }
 
-void PeriodicTask::cancelTask(std::shared_ptr<Task> pTask)
+bool PeriodicTask::cancelTask(std::shared_ptr<Task> pTask)
 {
+  bool result;
+
+  mMutexTasks.lock();
+    result = std::erase_if( mTasks, [&](const TaskEntry& aTask){ return aTask.pTask == pTask; } ) > 0;
+  mMutexTasks.unlock();
+
+  return result;
+}
+
+bool PeriodicTask::isEmpty(void)
+{
+  bool result;
+
+  mMutexTasks.lock();
+    result = mTasks.empty();
+  mMutexTasks.unlock();
+
+  return result;
+}
+
+PeriodicTask::Statistics PeriodicTask::getStatistics(void)
+{
+  Statistics result;
+
+  result.nTicks = mNumOfTicks.load( std::memory_order_relaxed );
+  result.nOverruns = mNumOfOverruns.load( std::memory_order_relaxed );
+  result.nSkippedTicks = mNumOfSkippedTicks.load( std::memory_order_relaxed );
+  result.startJitter = mStartJitter.getSnapshot();
+  result.executionTime = mExecutionTime.getSnapshot();
+
+  return result;
+}
+
+bool PeriodicTask::getTaskStatistics(std::shared_ptr<Task> pTask, TaskStatistics& statistics)
+{
+  bool result = false;
+
+  mMutexTasks.lock();
+    for( auto& aTask : mTasks ){
+      if( aTask.pTask == pTask ){
+        statistics.executionTime = aTask.pExecutionTime->getSnapshot();
+        statistics.nExecutions = statistics.executionTime.nCount;
+        statistics.nOverruns = aTask.pNumOfOverruns->load( std::memory_order_relaxed );
+        result = true;
+        break;
+      }
+    }
+  mMutexTasks.unlock();
+
+  return result;
+}
+
+void PeriodicTask::setOverrunListener(std::shared_ptr<IOverrunListener> pListener)
+{
+  mMutexTasks.lock();
+    mOverrunListener = pListener;
+  mMutexTasks.unlock();
+}
+
+void PeriodicTask::onOverrun(std::chrono::nanoseconds lateness, uint64_t nSkippedTicks)
+{
+  std::shared_ptr<IOverrunListener> pListener;
+
   mMutexTasks.lock();
-    std::erase( mTasks, pTask );
+    pListener = mOverrunListener;
   mMutexTasks.unlock();
+
+  mNumOfOverruns.fetch_add( 1, std::memory_order_relaxed );
+  mNumOfSkippedTicks.fetch_add( nSkippedTicks, std::memory_order_relaxed );
+  if( pListener ){
+    pListener->onOverrun( mPeriod, lateness, nSkippedTicks );
+  }
 }
 
 void PeriodicTask::onExecute(void)
 {
-  std::chrono::high_resolution_clock::time_point lastTime = std::chrono::high_resolution_clock::now();
+  // the k-th tick is scheduled at the absolute deadline startTime + k * period, then the error doesn't accumulate
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  int64_t nTick = 0;
 
-  while( mIsRunning && !mStopRunning && !mTasks.empty() ){
-    // Adjust the next periodic with the actual execution time
-    std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - lastTime );
-    std::chrono::milliseconds delayMsec = std::chrono::milliseconds( mPeriodicMsec ) - duration;
-    if( delayMsec.count() < 0 ){
-      delayMsec = std::chrono::milliseconds( 0 );
-      std::cout << "warning: execution time is exceeded than the periodic duration" << std::endl;
+  if( mPeriod < std::chrono::milliseconds( 1 ) ){
+    HighResolutionSleep::setMinimumTimerSlack();
+  }
+
+  while( mIsRunning && !mStopRunning && !isEmpty() ){
+    nTick++;
+    std::chrono::steady_clock::time_point deadline = startTime + mPeriod * nTick;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if( now > deadline && mPeriod.count() > 0 ){
+      // the previous execution exceeded this tick's deadline
+      std::chrono::nanoseconds lateness = now - deadline;
+      uint64_t nSkippedTicks = 0;
+      switch( mOverrunPolicy ){
+        case OverrunPolicy::SKIP:
+          nSkippedTicks = ( now - startTime ) / mPeriod + 1 - nTick;
+          nTick += nSkippedTicks;
+          deadline = startTime + mPeriod * nTick;
+          break;
+        case OverrunPolicy::CATCH_UP:
+          break;
+        case OverrunPolicy::COALESCE:
+          nSkippedTicks = lateness / mPeriod;
+          startTime = now - mPeriod * nTick;
+          deadline = now;
+          break;
+      }
+      onOverrun( lateness, nSkippedTicks );
+    }
+    HighResolutionSleep::sleepUntil( deadline, mSpinDuration );
+    if( mStopRunning ){
+      break;
     }
-    std::this_thread::sleep_for( delayMsec );
+    std::chrono::steady_clock::time_point tickStartTime = std::chrono::steady_clock::now();
+    mStartJitter.record( tickStartTime - deadline );
 
-    lastTime = std::chrono::high_resolution_clock::now();
+    // execute out of the lock, then the task can cancel itself
     mMutexTasks.lock();
-      for( auto& pTask : mTasks ){
-        if( mStopRunning ) break;
-        pTask->onExecute();
-      }
+      mExecutingTasks = mTasks;
     mMutexTasks.unlock();
+
+    if( mThreadPool && mExecutingTasks.size() > 1 ){
+      executeTasksInParallel();
+    } else {
+      executeTasks();
+    }
+    mExecutionTime.record( std::chrono::steady_clock::now() - tickStartTime );
+    mNumOfTicks.fetch_add( 1, std::memory_order_relaxed );
+    mExecutingTasks.clear();
   }
 }
 
+void PeriodicTask::executeTask(const TaskEntry& aTask)
+{
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  aTask.pTask->onExecute();
+  std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startTime;
+
+  aTask.pExecutionTime->record( duration );
+  if( duration > mPeriod ){
+    aTask.pNumOfOverruns->fetch_add( 1, std::memory_order_relaxed );
+  }
+}
+
+void PeriodicTask::executeTasks(void)
+{
+  for( auto& aTask : mExecutingTasks ){
+    if( mStopRunning ) break;
+    executeTask( aTask );
+  }
+}
+
+void PeriodicTask::executeTasksInParallel(void)
+{
+  // the barrier is per tick, then the late completion of the cancelled tick doesn't affect the next one
+  std::shared_ptr<CompletionBarrier> pBarrier = std::make_shared<CompletionBarrier>();
+  pBarrier->nNumOfPendingTasks = mExecutingTasks.size();
+  mMutexTasks.lock();
+    mBarrier = pBarrier;
+  mMutexTasks.unlock();
+
+  std::shared_ptr<PeriodicTask> pThis = std::static_pointer_cast<PeriodicTask>( shared_from_this() );
+  for( auto& aTask : mExecutingTasks ){
+    mThreadPool->addTask( ThreadPool::makeTask<LambdaTask>( [pThis, aTask, pBarrier](std::shared_ptr<Task> pWrapper){
+      pThis->executeTask( aTask );
+      pBarrier->mutex.lock();
+        pBarrier->nNumOfPendingTasks--;
+      pBarrier->mutex.unlock();
+      pBarrier->condition.notify_one();
+    } ) );
+  }
+
+  std::unique_lock<std::mutex> lock( pBarrier->mutex );
+  pBarrier->condition.wait( lock, [&]{ return !pBarrier->nNumOfPendingTasks || mStopRunning; } );
+}
+
 void PeriodicTask::cancel(void)
 {
+  std::shared_ptr<CompletionBarrier> pBarrier;
+
+  // mPeriod is kept, the periodic thread is still reading it. mStopRunning ends the loop
   mStopRunning = true;
-  mPeriodicMsec = 0;
+  // the tasks are kept for getTaskStatistics() after the stop
   mMutexTasks.lock();
-    mTasks.clear();
+    pBarrier = mBarrier;
   mMutexTasks.unlock();
+
+  // release the tick waiting for the dispatched tasks
+  if( pBarrier ){
+    pBarrier->mutex.lock();
+    pBarrier->mutex.unlock();
+    pBarrier->condition.notify_all();
+  }
 }
 
 
-PeriodicTaskPool::PeriodicTaskPool(int nPeriodMSec) : mPeriodicMsec( nPeriodMSec )
+PeriodicTaskPool::PeriodicTaskPool(std::chrono::nanoseconds period, PeriodicTask::OverrunPolicy overrunPolicy, std::chrono::nanoseconds spinDuration, std::shared_ptr<ThreadPool> pThreadPool) : mPeriod( period ), mOverrunPolicy( overrunPolicy ), mSpinDuration( spinDuration ), mThreadPool( pThreadPool )
 {
 
 }
@@ -80,10 +238,12 @@ std::shared_ptr<PeriodicTask> PeriodicTaskPool::getPeriodicTask(void)
   std::shared_ptr<PeriodicTask> result;
 
   mTaskMutex.lock();
-    if( mTasks.empty() ){
-      mTasks.push_back( std::make_shared<PeriodicTask>( mPeriodicMsec ) );
+    result = mPeriodicTask.load();
+    if( !result ){
+      result = std::make_shared<PeriodicTask>( mPeriod, mOverrunPolicy, mSpinDuration, mThreadPool );
+      result->setOverrunListener( mOverrunListener );
+      mPeriodicTask.store( result );
     }
-    result = std::dynamic_pointer_cast<PeriodicTask>( mTasks.front() );
   mTaskMutex.unlock();
 
   return result;
@@ -96,12 +256,13 @@ void PeriodicTaskPool::enqueue(std::shared_ptr<ITask> pTask)
 
   mTaskMutex.lock();
     if( pPeriodTask ){
-      std::shared_ptr<Task> theTask = std::dynamic_pointer_cast<Task>( pTask );
+      std::shared_ptr<Task> theTask = Task::toTask( pTask );
       if( theTask ){
         pPeriodTask->addTask( theTask );
       }
     }
   mTaskMutex.unlock();
+  notifyWaiter();
 }
 
 std::shared_ptr<ITask> PeriodicTaskPool::dequeue(void)
@@ -109,36 +270,86 @@ std::shared_ptr<ITask> PeriodicTaskPool::dequeue(void)
   std::shared_ptr<ITask> result;
 
   mTaskMutex.lock();
-    if( !mTasks.empty() ){
-      result = mTasks.front();
+    if( !isEmpty() ){
+      result = mPeriodicTask.load();
     }
   mTaskMutex.unlock();
 
   return result;
 }
 
-void PeriodicTaskPool::erase(std::shared_ptr<ITask> pTask)
+void PeriodicTaskPool::enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  for( auto& pTask : tasks ){
+    enqueue( pTask );
+  }
+}
+
+size_t PeriodicTaskPool::dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks)
+{
+  // the whole period is the single PeriodicTask
+  size_t result = 0;
+  std::shared_ptr<ITask> pTask = nMaxTasks ? dequeue() : nullptr;
+  if( pTask ){
+    tasks.push_back( pTask );
+    result++;
+  }
+  return result;
+}
+
+bool PeriodicTaskPool::erase(std::shared_ptr<ITask> pTask)
 {
+  bool result = false;
   std::shared_ptr<PeriodicTask> pPeriodTask = getPeriodicTask();
 
   if( pPeriodTask ){
-    std::shared_ptr<Task> theTask = std::dynamic_pointer_cast<Task>( pTask );
+    std::shared_ptr<Task> theTask = Task::toTask( pTask );
     if( theTask ){
-      pPeriodTask->cancelTask( theTask );
+      result = pPeriodTask->cancelTask( theTask );
     }
   }
+
+  return result;
+}
+
+bool PeriodicTaskPool::isEmpty(void)
+{
+  // the PeriodicTask is never dequeued, then the pool is empty when no task is registered to it
+  std::shared_ptr<PeriodicTask> pPeriodicTask = mPeriodicTask.load();
+  return !pPeriodicTask || pPeriodicTask->isEmpty();
 }
 
 void PeriodicTaskPool::clear(void)
 {
-  if( !mTasks.empty() ){
-    mTasks.clear();
-    mTasks.push_back( std::make_shared<PeriodicTask>( mPeriodicMsec ) );
-  }
+  mTaskMutex.lock();
+    if( mPeriodicTask.load() ){
+      std::shared_ptr<PeriodicTask> pPeriodicTask = std::make_shared<PeriodicTask>( mPeriod, mOverrunPolicy, mSpinDuration, mThreadPool );
+      pPeriodicTask->setOverrunListener( mOverrunListener );
+      mPeriodicTask.store( pPeriodicTask );
+    }
+  mTaskMutex.unlock();
 }
 
+PeriodicTask::Statistics PeriodicTaskPool::getStatistics(void)
+{
+  return getPeriodicTask()->getStatistics();
+}
 
-PeriodicTaskManager::PeriodicTaskManager()
+bool PeriodicTaskPool::getTaskStatistics(std::shared_ptr<Task> pTask, PeriodicTask::TaskStatistics& statistics)
+{
+  return getPeriodicTask()->getTaskStatistics( pTask, statistics );
+}
+
+void PeriodicTaskPool::setOverrunListener(std::shared_ptr<PeriodicTask::IOverrunListener> pListener)
+{
+  mTaskMutex.lock();
+    mOverrunListener = pListener;
+  mTaskMutex.unlock();
+  getPeriodicTask()->setOverrunListener( pListener );
+}
+
+
+PeriodicTaskManager::PeriodicTaskManager(PeriodicTask::OverrunPolicy overrunPolicy, std::chrono::nanoseconds spinDuration, std::shared_ptr<ThreadPool> pThreadPool) : mOverrunPolicy( overrunPolicy ), mSpinDuration( spinDuration ), mThreadPool( pThreadPool )
 {
 
 }
@@ -148,12 +359,12 @@ PeriodicTaskManager::~PeriodicTaskManager()
 
 }
 
-bool PeriodicTaskManager::isEmpty(int nPeriodMSec)
+bool PeriodicTaskManager::isEmpty(std::chrono::nanoseconds period)
 {
   bool result = true;
 
-  if( mTaskPool.contains( nPeriodMSec ) ){
-    result = mTaskPool[nPeriodMSec]->isEmpty();
+  if( mTaskPool.contains( period ) ){
+    result = mTaskPool[period]->isEmpty();
   }
 
   return result;
@@ -161,14 +372,25 @@ bool PeriodicTaskManager::isEmpty(int nPeriodMSec)
 
 
 void PeriodicTaskManager::scheduleRepeat(std::shared_ptr<Task> pTask, int nPeriodMSec)
+{
+  scheduleRepeat( pTask, std::chrono::milliseconds( nPeriodMSec ) );
+}
+
+void PeriodicTaskManager::scheduleRepeat(std::shared_ptr<Task> pTask, std::chrono::nanoseconds period)
 {
   mMutex.lock();
-    if( !mTaskPool.contains( nPeriodMSec ) ){
-      std::shared_ptr<ThreadPool::TaskPool> pTaskPool = std::make_shared<PeriodicTaskPool>( nPeriodMSec );
-      mTaskPool.insert_or_assign( nPeriodMSec, pTaskPool );
-      mThreads.insert_or_assign( nPeriodMSec, std::make_shared<ThreadPool::ThreadExector>( pTaskPool ) );
+    mTerminatedTaskPool.clear();
+    if( !mTaskPool.contains( period ) ){
+      std::shared_ptr<PeriodicTaskPool> pTaskPool = std::make_shared<PeriodicTaskPool>( period, mOverrunPolicy, mSpinDuration, mThreadPool );
+      pTaskPool->setOverrunListener( mOverrunListener );
+      mTaskPool.insert_or_assign( period, pTaskPool );
+      std::shared_ptr<ThreadPool::ThreadExector> pThread = std::make_shared<ThreadPool::ThreadExector>( pTaskPool );
+      if( mAffinities.contains( period ) ){
+        pThread->setAffinity( mAffinities[ period ] );
+      }
+      mThreads.insert_or_assign( period, pThread );
     }
-    std::shared_ptr<ThreadPool::TaskPool> pTaskPool = mTaskPool[ nPeriodMSec ];
+    std::shared_ptr<PeriodicTaskPool> pTaskPool = mTaskPool[ period ];
     if( pTaskPool ){
       pTaskPool->enqueue( pTask );
     }
@@ -178,28 +400,90 @@ void PeriodicTaskManager::scheduleRepeat(std::shared_ptr<Task> pTask, int nPerio
 void PeriodicTaskManager::cancelScheduleRepeat(std::shared_ptr<Task> pTask)
 {
   mMutex.lock();
-    std::vector<int> emptyPeriods;
+    std::vector<std::chrono::nanoseconds> emptyPeriods;
 
-    for( auto& [ nPeriodMSec, pTaskPool] : mTaskPool ){
+    for( auto& [ period, pTaskPool] : mTaskPool ){
       if( pTaskPool ){
         pTaskPool->erase( pTask );
-        if( isEmpty( nPeriodMSec ) ){
-          emptyPeriods.push_back( nPeriodMSec );
+        if( isEmpty( period ) ){
+          emptyPeriods.push_back( period );
         }
       }
     }
 
-    for( auto& nPeriodMSec : emptyPeriods ){
-      mTaskPool.erase( nPeriodMSec );
-      mThreads[nPeriodMSec]->terminate();
-      mThreads.erase( nPeriodMSec );
+    for( auto& period : emptyPeriods ){
+      mTaskPool.erase( period );
+      mThreads[period]->terminate();
+      mThreads.erase( period );
+    }
+  mMutex.unlock();
+}
+
+std::map<std::chrono::nanoseconds, PeriodicTask::Statistics> PeriodicTaskManager::getStatistics(void)
+{
+  std::map<std::chrono::nanoseconds, PeriodicTask::Statistics> result;
+
+  mMutex.lock();
+    for( auto& [ period, pTaskPool ] : ( mTaskPool.empty() ? mTerminatedTaskPool : mTaskPool ) ){
+      result.insert_or_assign( period, pTaskPool->getStatistics() );
+    }
+  mMutex.unlock();
+
+  return result;
+}
+
+PeriodicTask::TaskStatistics PeriodicTaskManager::getTaskStatistics(std::shared_ptr<Task> pTask)
+{
+  PeriodicTask::TaskStatistics result;
+
+  mMutex.lock();
+    for( auto& [ period, pTaskPool ] : ( mTaskPool.empty() ? mTerminatedTaskPool : mTaskPool ) ){
+      PeriodicTask::TaskStatistics statistics;
+      if( pTaskPool->getTaskStatistics( pTask, statistics ) ){
+        result.nExecutions += statistics.nExecutions;
+        result.nOverruns += statistics.nOverruns;
+        result.executionTime.merge( statistics.executionTime );
+      }
+    }
+  mMutex.unlock();
+
+  return result;
+}
+
+void PeriodicTaskManager::setOverrunListener(std::shared_ptr<PeriodicTask::IOverrunListener> pListener)
+{
+  mMutex.lock();
+    mOverrunListener = pListener;
+    for( auto& [ period, pTaskPool ] : mTaskPool ){
+      pTaskPool->setOverrunListener( pListener );
     }
   mMutex.unlock();
 }
 
+bool PeriodicTaskManager::setAffinity(std::chrono::nanoseconds period, const std::vector<int>& cpus)
+{
+  bool result = true;
+
+  mMutex.lock();
+    if( cpus.empty() ){
+      mAffinities.erase( period );
+    } else {
+      mAffinities.insert_or_assign( period, cpus );
+    }
+    if( mThreads.contains( period ) ){
+      result = mThreads[ period ]->setAffinity( cpus );
+    }
+  mMutex.unlock();
+
+  return result;
+}
+
 void PeriodicTaskManager::execute(void)
 {
-  for( auto& [ nPeriodMSec, pThread ] : mThreads ){
+  if( mThreadPool ){
+    mThreadPool->execute();
+  }
+  for( auto& [ period, pThread ] : mThreads ){
     if( pThread ){
       pThread->execute();
     }
@@ -208,11 +492,16 @@ void PeriodicTaskManager::execute(void)
 
 void PeriodicTaskManager::terminate(void)
 {
-  for( auto& [ nPeriodMSec, pThread ] : mThreads ){
+  for( auto& [ period, pThread ] : mThreads ){
     if( pThread ){
       pThread->terminate();
     }
   }
   mThreads.clear();
-  mTaskPool.clear();
+  mMutex.lock();
+    if( !mTaskPool.empty() ){
+      mTerminatedTaskPool.swap( mTaskPool );
+      mTaskPool.clear();
+    }
+  mMutex.unlock();
 }
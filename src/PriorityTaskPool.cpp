@@ -0,0 +1,232 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "PriorityTaskPool.hpp"
+
+PriorityTaskPool::PriorityTaskPool(std::chrono::nanoseconds agingInterval) : mNumOfTasks( 0 ), mNumOfHighPriorityTasks( 0 ), mAgingInterval( agingInterval )
+{
+}
+
+PriorityTaskPool::~PriorityTaskPool()
+{
+  clear();
+}
+
+int PriorityTaskPool::getQueueIndex(std::shared_ptr<ITask>& pTask)
+{
+  int nPriority = pTask->getPriority();
+  return ( nPriority < 0 ) ? 0 : ( ( nPriority < ITask::NUM_OF_PRIORITIES ) ? nPriority : ( ITask::NUM_OF_PRIORITIES - 1 ) );
+}
+
+void PriorityTaskPool::pushTask(std::shared_ptr<ITask>& pTask, std::chrono::steady_clock::time_point now)
+{
+  int nIndex = getQueueIndex( pTask );
+  AgingTask aTask;
+  aTask.pTask = pTask;
+  aTask.nSequence = mSequence++;
+  aTask.enqueueTime = now;
+  mPriorityTasks[nIndex].push_back( std::move( aTask ) );
+  mNumOfTasks++;
+  if( nIndex > ITask::PRIORITY_NORMAL ){
+    mNumOfHighPriorityTasks++;
+  }
+}
+
+void PriorityTaskPool::enqueue(std::shared_ptr<ITask> pTask)
+{
+  if( pTask ){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    mTaskMutex.lock();
+      pushTask( pTask, now );
+      updateMaxDepth( mNumOfTasks + mNumOfInplaceTasks );
+    mTaskMutex.unlock();
+    notifyWaiter();
+  }
+}
+
+void PriorityTaskPool::enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  size_t nNumOfTasks = 0;
+
+  mTaskMutex.lock();
+    for( auto pTask : tasks ){
+      if( pTask ){
+        pushTask( pTask, now );
+        nNumOfTasks++;
+      }
+    }
+    updateMaxDepth( mNumOfTasks + mNumOfInplaceTasks );
+  mTaskMutex.unlock();
+  notifyWaiters( nNumOfTasks );
+}
+
+int PriorityTaskPool::getNextQueue(void)
+{
+  int result = -1;
+  int nNumOfQueues = 0;
+
+  for( int i = ITask::NUM_OF_PRIORITIES - 1; i >= 0; i-- ){
+    if( !mPriorityTasks[i].empty() ){
+      nNumOfQueues++;
+      if( result < 0 ){
+        result = i;
+      }
+    }
+  }
+
+  // the lower queue's front is the oldest in it, then only the fronts need the aging check
+  if( nNumOfQueues > 1 && mAgingInterval.count() > 0 ){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    int64_t nBestPriority = result + ( now - mPriorityTasks[result].front().enqueueTime ) / mAgingInterval;
+    for( int i = result - 1; i >= 0; i-- ){
+      if( !mPriorityTasks[i].empty() ){
+        int64_t nPriority = i + ( now - mPriorityTasks[i].front().enqueueTime ) / mAgingInterval;
+        if( nPriority > nBestPriority ){
+          nBestPriority = nPriority;
+          result = i;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+bool PriorityTaskPool::popTask(std::shared_ptr<ITask>& pTask)
+{
+  int nIndex = getNextQueue();
+  if( nIndex < 0 ){
+    return false;
+  }
+
+  std::deque<AgingTask>& tasks = mPriorityTasks[nIndex];
+  if( !isErased( tasks.front() ) ){
+    pTask = std::move( tasks.front().pTask );
+  }
+  tasks.pop_front();
+  mNumOfTasks--;
+  if( nIndex > ITask::PRIORITY_NORMAL ){
+    mNumOfHighPriorityTasks--;
+  }
+
+  return true;
+}
+
+void PriorityTaskPool::clearConsumedTombstones(void)
+{
+  if( !mTombstones.empty() ){
+    // every entry older than the last tombstone is consumed, then no tombstone is effective any more
+    bool bEffective = false;
+    for( auto& tasks : mPriorityTasks ){
+      bEffective |= !tasks.empty() && tasks.front().nSequence < mLastTombstone;
+    }
+    if( !bEffective ){
+      mTombstones.clear();
+    }
+  }
+}
+
+std::shared_ptr<ITask> PriorityTaskPool::dequeue(void)
+{
+  std::shared_ptr<ITask> result;
+
+  mTaskMutex.lock();
+    while( !result && popTask( result ) );
+    clearConsumedTombstones();
+  mTaskMutex.unlock();
+
+  return result;
+}
+
+size_t PriorityTaskPool::dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks)
+{
+  size_t result = 0;
+  std::shared_ptr<ITask> pTask;
+
+  mTaskMutex.lock();
+    while( result < nMaxTasks && popTask( pTask ) ){
+      if( pTask ){
+        tasks.push_back( std::move( pTask ) );
+        result++;
+      }
+    }
+    clearConsumedTombstones();
+  mTaskMutex.unlock();
+
+  return result;
+}
+
+bool PriorityTaskPool::erase(std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  mTaskMutex.lock();
+    if( pTask && mNumOfTasks ){
+      for( auto& tasks : mPriorityTasks ){
+        for( auto& aTask : tasks ){
+          if( aTask.pTask == pTask && !isErased( aTask ) ){
+            result = true;
+            break;
+          }
+        }
+        if( result ){
+          break;
+        }
+      }
+    }
+    if( result ){
+      mTombstones.insert_or_assign( pTask.get(), mSequence );
+      mLastTombstone = mSequence;
+    }
+  mTaskMutex.unlock();
+
+  return result;
+}
+
+void PriorityTaskPool::clear(void)
+{
+  std::vector<std::shared_ptr<ITask>> abandonedTasks;
+
+  mTaskMutex.lock();
+    for( auto& tasks : mPriorityTasks ){
+      for( auto& aTask : tasks ){
+        abandonedTasks.push_back( std::move( aTask.pTask ) );
+      }
+      tasks.clear();
+    }
+    mNumOfTasks = 0;
+    mNumOfHighPriorityTasks = 0;
+  mTaskMutex.unlock();
+  abandonTasks( abandonedTasks );
+  TaskPool::clear();
+}
+
+bool PriorityTaskPool::isEmpty(void)
+{
+  return !mNumOfTasks && !mNumOfInplaceTasks;
+}
+
+bool PriorityTaskPool::dequeueInplace(InplaceTask& task)
+{
+  return !mNumOfHighPriorityTasks && TaskPool::dequeueInplace( task );
+}
+
+size_t PriorityTaskPool::getDepth(void)
+{
+  return mNumOfTasks + mNumOfInplaceTasks;
+}
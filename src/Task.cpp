@@ -18,8 +18,9 @@
 #include "Task.hpp"
 
 
-Task::Task() : ITask(), mIsRunning(false), mStopRunning(false)
+Task::Task() : ITask(), mIsRunning(false), mStopRunning(false), mIsInFlight(false), mNumOfWaiters(0)
 {
+  mTask = this;
 
 }
 
@@ -33,7 +34,7 @@ void Task::_execute(std::shared_ptr<Task::ITaskNotifier> pNotifier)
 {
   execute();
   if( pNotifier ){
-    pNotifier->onTaskCompletion( std::dynamic_pointer_cast<ITask>( shared_from_this() ) );
+    pNotifier->onTaskCompletion( shared_from_this() );
   }
 }
 
@@ -45,11 +46,76 @@ void Task::execute(void)
     onComplete();
   mIsRunning = false;
   mStopRunning = false;
+  mIsInFlight = false;
+  notifyCompletion();
+}
+
+void Task::onAbandon(void)
+{
+  if( !mIsRunning ){
+    mIsInFlight = false;
+    notifyCompletion();
+  }
+}
+
+void Task::notifyCompletion(void)
+{
+  // mIsRunning and mNumOfWaiters are seq_cst : either the waiter sees the completion or we see the waiter
+  if( mNumOfWaiters ){
+    mMutexCompletion.lock();
+    mMutexCompletion.unlock();
+    mCompletionCondition.notify_all();
+  }
+}
+
+void Task::waitForCompletion(void)
+{
+  std::unique_lock<std::mutex> lock( mMutexCompletion );
+  mNumOfWaiters++;
+  mCompletionCondition.wait( lock, [&]{ return !mIsRunning; } );
+  mNumOfWaiters--;
+}
+
+bool Task::waitForCompletion(std::chrono::nanoseconds timeout)
+{
+  bool result;
+
+  std::unique_lock<std::mutex> lock( mMutexCompletion );
+  mNumOfWaiters++;
+  if( timeout == std::chrono::nanoseconds::max() ){
+    mCompletionCondition.wait( lock, [&]{ return !mIsRunning; } );
+    result = true;
+  } else {
+    result = mCompletionCondition.wait_for( lock, timeout, [&]{ return !mIsRunning; } );
+  }
+  mNumOfWaiters--;
+
+  return result;
+}
+
+bool Task::waitForCompletion(const std::vector<std::shared_ptr<Task>>& tasks, std::chrono::nanoseconds timeout)
+{
+  bool result = true;
+  std::chrono::steady_clock::time_point deadline = ( timeout == std::chrono::nanoseconds::max() ) ? std::chrono::steady_clock::time_point::max() : std::chrono::steady_clock::now() + timeout;
+
+  // the total waiting time is the slowest task's, not the sum of them
+  for( auto& pTask : tasks ){
+    if( pTask ){
+      if( deadline == std::chrono::steady_clock::time_point::max() ){
+        pTask->waitForCompletion();
+      } else {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        result = pTask->waitForCompletion( ( deadline > now ) ? std::chrono::duration_cast<std::chrono::nanoseconds>( deadline - now ) : std::chrono::nanoseconds( 0 ) ) && result;
+      }
+    }
+  }
+
+  return result;
 }
 
 void Task::executeThreadFunc(std::shared_ptr<ITask> pTask, std::shared_ptr<Task::ITaskNotifier> pNotifier)
 {
-  std::shared_ptr<Task> pTaskAdmin = std::dynamic_pointer_cast<Task>( pTask );
+  Task* pTaskAdmin = pTask ? pTask->getTask() : nullptr;
   if( pTaskAdmin ){
     pTaskAdmin->_execute( pNotifier );
   }
@@ -0,0 +1,243 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include "TaskGraph.hpp"
+
+#include <future>
+
+TaskGraph::Node::Node(TaskGraph* pGraph, size_t nIndex, std::shared_ptr<ITask> pTask) : mGraph( pGraph ), mIndex( nIndex ), mTask( pTask ), mNumOfPredecessors( 0 ), mNumOfPendingPredecessors( 0 ), mIsClaimed( true )
+{
+  if( mTask ){
+    setPriority( mTask->getPriority() );
+  }
+}
+
+TaskGraph::Node::~Node()
+{
+}
+
+void TaskGraph::Node::addPredecessor(std::shared_ptr<Node> pPredecessor)
+{
+  if( pPredecessor && pPredecessor->mGraph == mGraph && pPredecessor.get() != this ){
+    pPredecessor->mSuccessors.push_back( mIndex );
+    mNumOfPredecessors++;
+    mGraph->mIsValidated = false;
+  }
+}
+
+bool TaskGraph::Node::claim(void)
+{
+  // the node is counted down only once even if it's cancelled, dropped or abandoned after it ran
+  bool bExpected = false;
+  return mIsClaimed.compare_exchange_strong( bExpected, true, std::memory_order_acq_rel );
+}
+
+void TaskGraph::Node::executeTask(void)
+{
+  if( mTask ){
+    // the failed node is still counted down, then wait() doesn't hang
+    try {
+      Task* pFullTask = mTask->getTask();
+      if( pFullTask ){
+        pFullTask->execute();
+      } else {
+        mTask->onExecute();
+        mTask->onComplete();
+      }
+    } catch (...) {
+      mGraph->setException( std::current_exception() );
+    }
+  }
+}
+
+void TaskGraph::Node::execute(void)
+{
+  // the caller already claimed this
+  TaskGraph* pGraph = mGraph;
+  std::vector<Node*> readyNodes = { this };
+
+  while( !readyNodes.empty() ){
+    Node* pNode = readyNodes.back();
+    readyNodes.pop_back();
+    // the abandoned graph skips the tasks, and doesn't add the node to ThreadPool which may be terminated
+    bool bAbandoned = pGraph->mIsAbandoned.load( std::memory_order_acquire );
+    if( !bAbandoned ){
+      pNode->executeTask();
+    }
+
+    bool bHasNextNode = false;
+    for( size_t nIndex : pNode->mSuccessors ){
+      std::shared_ptr<Node>& pSuccessor = pGraph->mNodes[nIndex];
+      if( pSuccessor->mNumOfPendingPredecessors.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ){
+        if( bAbandoned || !bHasNextNode ){
+          // the successor abandoned before it became ready was already counted
+          if( pSuccessor->claim() ){
+            readyNodes.push_back( pSuccessor.get() );
+            bHasNextNode = true;
+          }
+        } else {
+          pGraph->mThreadPool->addTask( pSuccessor );
+        }
+      }
+    }
+    // the graph may be released after the last node, then touch nothing after this
+    pGraph->onNodeComplete();
+  }
+}
+
+void TaskGraph::Node::onExecute(void)
+{
+  if( claim() ){
+    execute();
+  }
+}
+
+void TaskGraph::Node::onAbandon(void)
+{
+  if( claim() ){
+    mGraph->setException( std::make_exception_ptr( std::future_error( std::future_errc::broken_promise ) ) );
+    mGraph->mIsAbandoned.store( true, std::memory_order_release );
+    execute();
+  }
+}
+
+
+TaskGraph::TaskGraph() : mIsValidated( false ), mIsAcyclic( false ), mNumOfRemainingNodes( 0 ), mIsRunning( false ), mIsAbandoned( false )
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+  waitForCompletion();
+}
+
+std::shared_ptr<TaskGraph::Node> TaskGraph::addNode(std::shared_ptr<ITask> pTask)
+{
+  std::shared_ptr<Node> pNode = std::make_shared<Node>( this, mNodes.size(), pTask );
+  mNodes.push_back( pNode );
+  mIsValidated = false;
+  return pNode;
+}
+
+void TaskGraph::clear(void)
+{
+  waitForCompletion();
+  mNodes.clear();
+  mRootNodes.clear();
+  mIsValidated = false;
+}
+
+bool TaskGraph::validate(void)
+{
+  if( !mIsValidated ){
+    // Kahn's algorithm : every node is visited only if there is no cycle
+    std::vector<int> numOfPredecessors( mNodes.size() );
+    std::vector<size_t> readyNodes;
+    mRootNodes.clear();
+    for( auto& pNode : mNodes ){
+      numOfPredecessors[pNode->mIndex] = pNode->mNumOfPredecessors;
+      if( !pNode->mNumOfPredecessors ){
+        readyNodes.push_back( pNode->mIndex );
+        mRootNodes.push_back( pNode );
+      }
+    }
+    size_t nNumOfVisited = 0;
+    while( !readyNodes.empty() ){
+      size_t nIndex = readyNodes.back();
+      readyNodes.pop_back();
+      nNumOfVisited++;
+      for( size_t nSuccessor : mNodes[nIndex]->mSuccessors ){
+        if( --numOfPredecessors[nSuccessor] == 0 ){
+          readyNodes.push_back( nSuccessor );
+        }
+      }
+    }
+    mIsAcyclic = ( nNumOfVisited == mNodes.size() );
+    mIsValidated = true;
+  }
+
+  return mIsAcyclic;
+}
+
+bool TaskGraph::run(std::shared_ptr<ThreadPool> pThreadPool)
+{
+  if( !pThreadPool || isRunning() || !validate() ){
+    return false;
+  }
+  if( mNodes.empty() ){
+    return true;
+  }
+
+  for( auto& pNode : mNodes ){
+    pNode->mNumOfPendingPredecessors.store( pNode->mNumOfPredecessors, std::memory_order_relaxed );
+    pNode->mIsClaimed.store( false, std::memory_order_relaxed );
+  }
+  mThreadPool = pThreadPool;
+  mNumOfRemainingNodes.store( mNodes.size(), std::memory_order_relaxed );
+  mIsAbandoned.store( false, std::memory_order_relaxed );
+  mMutex.lock();
+    mIsRunning = true;
+    mException = nullptr;
+  mMutex.unlock();
+
+  mThreadPool->addTasks( mRootNodes );
+
+  return true;
+}
+
+void TaskGraph::onNodeComplete(void)
+{
+  if( mNumOfRemainingNodes.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ){
+    // notify under the lock, wait() may release the graph as soon as it sees !mIsRunning
+    std::lock_guard<std::mutex> lock( mMutex );
+    mIsRunning = false;
+    mCondition.notify_all();
+  }
+}
+
+void TaskGraph::setException(std::exception_ptr pException)
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  if( !mException ){
+    mException = pException;
+  }
+}
+
+void TaskGraph::waitForCompletion(void)
+{
+  std::unique_lock<std::mutex> lock( mMutex );
+  mCondition.wait( lock, [&]{ return !mIsRunning; } );
+}
+
+void TaskGraph::wait(void)
+{
+  std::unique_lock<std::mutex> lock( mMutex );
+  mCondition.wait( lock, [&]{ return !mIsRunning; } );
+  std::exception_ptr pException = mException;
+  mException = nullptr;
+  lock.unlock();
+
+  if( pException ){
+    std::rethrow_exception( pException );
+  }
+}
+
+bool TaskGraph::isRunning(void)
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mIsRunning;
+}
@@ -18,25 +18,85 @@
 #include "TaskManager.hpp"
 #include "Task.hpp"
 #include <chrono>
+#include <algorithm>
 
-#include <iostream>
 
+TaskManager::TaskRunner::TaskRunner(std::shared_ptr<Task> pTask, std::shared_ptr<TaskManager> pTaskManager) : mTask(pTask), mTaskManager(pTaskManager), mState(QUEUED)
+{
+
+}
 
-TaskManager::TaskManager(int nMaxThread) : mMaxThread(nMaxThread), mStopping(false)
+TaskManager::TaskRunner::~TaskRunner()
 {
 
 }
 
-TaskManager::~TaskManager()
+void TaskManager::TaskRunner::onExecute(void)
+{
+  int nState = QUEUED;
+  if( mState.compare_exchange_strong( nState, RUNNING ) ){
+    mTask->execute();
+    mState = DONE;
+
+    std::shared_ptr<TaskManager> pTaskManager = mTaskManager.lock();
+    if( pTaskManager ){
+      pTaskManager->onTaskCompletion( mTask );
+    }
+  }
+}
+
+void TaskManager::TaskRunner::cancel(void)
+{
+  // the runner's mIsRunning is already set when onExecute() took the task, then waitForCompletion() covers it
+  int nState = QUEUED;
+  if( !mState.compare_exchange_strong( nState, CANCELLED ) && nState == RUNNING ){
+    Task::cancel();
+    mTask->cancel();
+  }
+}
+
+void TaskManager::TaskRunner::onAbandon(void)
 {
+  int nState = QUEUED;
+  if( mState.compare_exchange_strong( nState, CANCELLED ) ){
+    if( isDeadlineMissed() ){
+      mTask->setDeadlineMissed();
+    }
+    mTask->onAbandon();
+    Task::onAbandon();
 
+    std::shared_ptr<TaskManager> pTaskManager = mTaskManager.lock();
+    if( pTaskManager ){
+      pTaskManager->onTaskAbandoned( mTask, isDeadlineMissed() );
+    }
+  }
+}
+
+
+TaskManager::TaskManager(int nMaxThread, std::shared_ptr<ThreadPool> pThreadPool) : mMaxThread(nMaxThread), mStopping(false), mThreadPool(pThreadPool), mIsOwnThreadPool(false)
+{
+  if( !mThreadPool ){
+    mThreadPool = std::make_shared<ThreadPool>( nMaxThread );
+    mIsOwnThreadPool = true;
+  }
+}
+
+TaskManager::~TaskManager()
+{
+  if( mIsOwnThreadPool ){
+    mThreadPool->terminate();
+  }
 }
 
 void TaskManager::addTask(std::shared_ptr<Task> pTask)
 {
   mMutexTasks.lock();
   {
-    mTasks.push_back(pTask);
+    // keep mTasks in the priority order, and FIFO in the same priority
+    auto it = std::upper_bound( mTasks.begin(), mTasks.end(), pTask, [](const std::shared_ptr<Task>& pTask1, const std::shared_ptr<Task>& pTask2){
+      return pTask1->getPriority() > pTask2->getPriority();
+    } );
+    mTasks.insert( it, pTask );
   }
   mMutexTasks.unlock();
 }
@@ -44,128 +104,133 @@ void TaskManager::addTask(std::shared_ptr<Task> pTask)
 void TaskManager::cancelTask(std::shared_ptr<Task> pTask, bool useJoin)
 {
   if( pTask ){
-    // cancel notify & wait & remove the task from mThreads
+    // cancel notify & wait & remove the task from mRunners
     mMutexTasks.lock();
     {
       std::erase( mTasks, pTask );
     }
     mMutexTasks.unlock();
 
-    std::shared_ptr<std::thread> pThread;
-    mMutexThreads.lock();
+    std::shared_ptr<TaskRunner> pRunner;
+    mMutexRunners.lock();
     {
-      pThread = mThreads[pTask];
-      mThreads.erase( pTask );
-    }
-    mMutexThreads.unlock();
-
-    if( pTask->isRunning() ){
-      pTask->cancel();
-      while( pTask->isRunning() ){
-        std::this_thread::sleep_for(std::chrono::microseconds(1000)); // 1 msec
+      auto it = mRunners.find( pTask );
+      if( it != mRunners.end() ){
+        pRunner = it->second;
+        mRunners.erase( it );
       }
     }
-    if( pThread ){
-      if( pThread->joinable() ){
-        if( useJoin ){
-          pThread->join();
-        } else {
-          pThread->detach();
-        }
-      }
+    mMutexRunners.unlock();
+
+    if( pRunner ){
+      pRunner->cancel();
+      mThreadPool->canceTask( pRunner );
+      pRunner->waitForCompletion();
     }
   }
 }
 
-void TaskManager::executeAllTasks(void)
+void TaskManager::dispatchTasks(void)
 {
-  mStopping = false;
+  std::vector<std::shared_ptr<TaskRunner>> runners;
 
-  // extract candidate tasks to execute
-  int nNumOfRunningTasks = mThreads.size();
-  if( nNumOfRunningTasks < mMaxThread ){
-    // enumerate candidate task to run
-    std::vector<std::shared_ptr<Task>> candidateTasks;
-    mMutexTasks.lock();
-    {
-      for( auto& pTask : mTasks ){
-        if( !pTask->isRunning() ){
-          candidateTasks.push_back( pTask );
-          nNumOfRunningTasks++;
-          if( nNumOfRunningTasks >= mMaxThread ){
-            break;
+  mMutexRunners.lock();
+  {
+    // extract candidate tasks to execute up to mMaxThread
+    int nNumOfRunningTasks = mRunners.size();
+    if( !mStopping && nNumOfRunningTasks < mMaxThread ){
+      mMutexTasks.lock();
+      {
+        for( auto it = mTasks.begin(); it != mTasks.end() && nNumOfRunningTasks < mMaxThread; ){
+          if( !(*it)->isRunning() && !mRunners.contains( *it ) ){
+            std::shared_ptr<TaskRunner> pRunner = ThreadPool::makeTask<TaskRunner>( *it, shared_from_this() );
+            pRunner->setPriority( (*it)->getPriority() );
+            if( (*it)->hasDeadline() ){
+              pRunner->setDeadline( (*it)->getDeadline() );
+            }
+            mRunners.insert_or_assign( *it, pRunner );
+            runners.push_back( pRunner );
+            nNumOfRunningTasks++;
+            it = mTasks.erase( it );
+          } else {
+            it++;
           }
         }
       }
+      mMutexTasks.unlock();
     }
-    mMutexTasks.unlock();
+  }
+  mMutexRunners.unlock();
 
-    // execute the extracted candidate tasks
-    mMutexThreads.lock();
-    {
-      for( auto& pTask : candidateTasks ) {
-        mMutexTasks.lock();
-        {
-          std::erase( mTasks, pTask );
-        }
-        mMutexTasks.unlock();
-        mThreads.insert_or_assign( pTask, std::make_shared<std::thread>( &Task::executeThreadFunc, pTask, shared_from_this() ) );
-      }
-    }
-    mMutexThreads.unlock();
+  // execute the extracted candidate tasks on the reused workers
+  for( auto& pRunner : runners ){
+    mThreadPool->addTask( pRunner );
   }
 }
 
-void TaskManager::stopAllTasks(void)
+void TaskManager::executeAllTasks(void)
 {
-  mStopping = true;
+  mMutexRunners.lock();
+  {
+    mStopping = false;
+  }
+  mMutexRunners.unlock();
 
-  mTasks.clear();
+  mThreadPool->execute();
+  dispatchTasks();
+}
 
-  while( isRunning() ) {
-    mMutexThreads.lock();
-    {
-      std::vector<std::shared_ptr<Task>> tasks;
-      for( auto& [ pTask, pThread ] : mThreads ){
-        if( pTask->isRunning() ){
-          pTask->cancel();
-        } else {
-          tasks.push_back( pTask );
-        }
-      }
+void TaskManager::stopAllTasks(void)
+{
+  std::map<std::shared_ptr<Task>, std::shared_ptr<TaskRunner>> runners;
 
-      for( auto& pTask : tasks ){
-        mThreads.erase( pTask );
-      }
-    }
-    mMutexThreads.unlock();
-    std::this_thread::yield();
+  mMutexRunners.lock();
+  {
+    mStopping = true;
+    runners.swap( mRunners );
+  }
+  mMutexRunners.unlock();
+
+  mMutexTasks.lock();
+  {
+    mTasks.clear();
   }
+  mMutexTasks.unlock();
 
-  mThreads.clear();
+  // cancel all at first, then wait for them at once
+  std::vector<std::shared_ptr<Task>> cancelledRunners;
+  for( auto& [ pTask, pRunner ] : runners ){
+    pRunner->cancel();
+    mThreadPool->canceTask( pRunner );
+    cancelledRunners.push_back( pRunner );
+  }
+  Task::waitForCompletion( cancelledRunners );
 }
 
 void TaskManager::onTaskCompletion(std::shared_ptr<ITask> pTask)
 {
   if( pTask ) {
-    cancelTask( std::dynamic_pointer_cast<Task>( pTask ) );
-    if( !mStopping ) {
-      executeAllTasks();
+    mMutexRunners.lock();
+    {
+      mRunners.erase( Task::toTask( pTask ) );
     }
+    mMutexRunners.unlock();
+
+    dispatchTasks();
   }
 }
 
 bool TaskManager::isRunning(void)
 {
   bool bRunning = false;
-  mMutexThreads.lock();
+  mMutexRunners.lock();
   {
-    for( auto& [ pTask, pThread ] : mThreads ){
-      bRunning |= pTask->isRunning();
+    for( auto& [ pTask, pRunner ] : mRunners ){
+      bRunning |= pRunner->isActive();
       if (bRunning) break;
     }
   }
-  mMutexThreads.unlock();
+  mMutexRunners.unlock();
   return bRunning;
 }
 
@@ -174,6 +239,30 @@ bool TaskManager::isRemainingTasks(void)
   return !mTasks.empty();
 }
 
+void TaskManager::enableMetrics(bool bEnabled)
+{
+  if( mThreadPool ){
+    mThreadPool->enableMetrics( bEnabled );
+  }
+}
+
+ThreadPool::Metrics TaskManager::getMetrics(void)
+{
+  ThreadPool::Metrics result;
+
+  if( mThreadPool ){
+    result = mThreadPool->getMetrics();
+  }
+  // the tasks waiting for the free worker are counted as queued
+  mMutexTasks.lock();
+  {
+    result.nQueueDepth += mTasks.size();
+  }
+  mMutexTasks.unlock();
+
+  return result;
+}
+
 void TaskManager::finalize(void)
 {
   stopAllTasks();
@@ -185,10 +274,23 @@ void TaskManager::finalize(void)
   }
   mMutexTasks.unlock();
 
-  // remove all threads
-  mMutexThreads.lock();
+  // remove all runners
+  mMutexRunners.lock();
+  {
+    mRunners.clear();
+  }
+  mMutexRunners.unlock();
+}
+
+void TaskManager::onTaskAbandoned(std::shared_ptr<Task> pTask, bool bDispatchNext)
+{
+  mMutexRunners.lock();
   {
-    mThreads.clear();
+    mRunners.erase( pTask );
+  }
+  mMutexRunners.unlock();
+
+  if( bDispatchNext ){
+    dispatchTasks();
   }
-  mMutexThreads.unlock();
 }
@@ -15,20 +15,65 @@
 */
 
 #include "ThreadPool.hpp"
+#include <algorithm>
 
-ThreadPool::TaskPool::TaskPool()
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// adaptive spin range of the idle ThreadExector before parking on the TaskPool
+static const int SPIN_COUNT_MIN = 8;
+static const int SPIN_COUNT_MAX = 1024;
+
+static thread_local ThreadPool::ThreadExector* gCurrentExector = nullptr;
+
+ThreadPool::TaskPool::TaskPool() : mSequence( 0 ), mLastTombstone( 0 ), mNumOfWaiters( 0 ), mInplaceHead( 0 ), mNumOfInplaceTasks( 0 ), mMaxDepth( 0 ), mNumOfLocalTasks( 0 )
 {
 }
 
 ThreadPool::TaskPool::~TaskPool()
 {
+  TaskPool::clear();
+}
+
+void ThreadPool::TaskPool::abandonTasks(std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  for( auto& pTask : tasks ){
+    if( pTask ){
+      pTask->onAbandon();
+    }
+  }
+  tasks.clear();
 }
 
 void ThreadPool::TaskPool::enqueue(std::shared_ptr<ITask> pTask)
 {
   mTaskMutex.lock();
-    mTasks.push_back( pTask );
+    mTasks.push_back( { pTask, mSequence++ } );
+    updateMaxDepth( mTasks.size() + mNumOfInplaceTasks );
   mTaskMutex.unlock();
+  notifyWaiter();
+}
+
+bool ThreadPool::TaskPool::isErased(const QueuedTask& aTask)
+{
+  bool result = false;
+
+  if( !mTombstones.empty() ){
+    auto it = mTombstones.find( aTask.pTask.get() );
+    result = ( it != mTombstones.end() ) && ( aTask.nSequence < it->second );
+  }
+
+  return result;
+}
+
+void ThreadPool::TaskPool::clearConsumedTombstones(void)
+{
+  // every entry older than the last tombstone is consumed, then no tombstone is effective any more
+  if( !mTombstones.empty() && ( mTasks.empty() || mTasks.front().nSequence >= mLastTombstone ) ){
+    mTombstones.clear();
+  }
 }
 
 std::shared_ptr<ITask> ThreadPool::TaskPool::dequeue(void)
@@ -36,37 +81,208 @@ std::shared_ptr<ITask> ThreadPool::TaskPool::dequeue(void)
   std::shared_ptr<ITask> result;
 
   mTaskMutex.lock();
-    if( !mTasks.empty() ){
-      result = mTasks.front();
-      std::erase( mTasks, result );
+    while( !result && !mTasks.empty() ){
+      if( !isErased( mTasks.front() ) ){
+        result = std::move( mTasks.front().pTask );
+      }
+      mTasks.pop_front();
     }
+    clearConsumedTombstones();
   mTaskMutex.unlock();
 
   return result;
 }
 
-void ThreadPool::TaskPool::erase(std::shared_ptr<ITask> pTask)
+void ThreadPool::TaskPool::enqueueBatch(const std::vector<std::shared_ptr<ITask>>& tasks)
 {
+  size_t nNumOfTasks = 0;
+
   mTaskMutex.lock();
-    std::erase( mTasks, pTask );
+    for( auto& pTask : tasks ){
+      if( pTask ){
+        mTasks.push_back( { pTask, mSequence++ } );
+        nNumOfTasks++;
+      }
+    }
+    updateMaxDepth( mTasks.size() + mNumOfInplaceTasks );
   mTaskMutex.unlock();
+  notifyWaiters( nNumOfTasks );
+}
+
+size_t ThreadPool::TaskPool::dequeueBatch(std::vector<std::shared_ptr<ITask>>& tasks, size_t nMaxTasks)
+{
+  size_t result = 0;
+
+  mTaskMutex.lock();
+    while( result < nMaxTasks && !mTasks.empty() ){
+      if( !isErased( mTasks.front() ) ){
+        tasks.push_back( std::move( mTasks.front().pTask ) );
+        result++;
+      }
+      mTasks.pop_front();
+    }
+    clearConsumedTombstones();
+  mTaskMutex.unlock();
+
+  return result;
+}
+
+bool ThreadPool::TaskPool::erase(std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  mTaskMutex.lock();
+    if( pTask ){
+      for( auto& aTask : mTasks ){
+        if( aTask.pTask == pTask && !isErased( aTask ) ){
+          result = true;
+          break;
+        }
+      }
+    }
+    if( result ){
+      mTombstones.insert_or_assign( pTask.get(), mSequence );
+      mLastTombstone = mSequence;
+    }
+  mTaskMutex.unlock();
+
+  return result;
 }
 
 void ThreadPool::TaskPool::clear(void)
 {
+  std::vector<std::shared_ptr<ITask>> abandonedTasks;
+
   mTaskMutex.lock();
+    for( auto& aTask : mTasks ){
+      abandonedTasks.push_back( std::move( aTask.pTask ) );
+    }
     mTasks.clear();
+    mTombstones.clear();
+    for( auto& aTask : mInplaceTasks ){
+      aTask.reset();
+    }
+    mInplaceHead = 0;
+    mNumOfInplaceTasks = 0;
   mTaskMutex.unlock();
+  abandonTasks( abandonedTasks );
 }
 
 bool ThreadPool::TaskPool::isEmpty(void)
 {
-  return mTasks.empty();
+  return mTasks.empty() && !mNumOfInplaceTasks;
+}
+
+void ThreadPool::TaskPool::enqueueInplace(InplaceTask&& task)
+{
+  mTaskMutex.lock();
+    size_t nSize = mInplaceTasks.size();
+    if( mNumOfInplaceTasks == nSize ){
+      // grow the ring by the power of two
+      std::vector<InplaceTask> tasks( nSize ? nSize * 2 : 64 );
+      for( size_t i = 0; i < nSize; i++ ){
+        tasks[i] = std::move( mInplaceTasks[ ( mInplaceHead + i ) & ( nSize - 1 ) ] );
+      }
+      mInplaceTasks.swap( tasks );
+      mInplaceHead = 0;
+    }
+    mInplaceTasks[ ( mInplaceHead + mNumOfInplaceTasks ) & ( mInplaceTasks.size() - 1 ) ] = std::move( task );
+    mNumOfInplaceTasks++;
+    updateMaxDepth( mTasks.size() + mNumOfInplaceTasks );
+  mTaskMutex.unlock();
+  notifyWaiter();
+}
+
+bool ThreadPool::TaskPool::dequeueInplace(InplaceTask& task)
+{
+  bool result = false;
+
+  if( mNumOfInplaceTasks ){
+    mTaskMutex.lock();
+      if( mNumOfInplaceTasks ){
+        task = std::move( mInplaceTasks[ mInplaceHead ] );
+        mInplaceHead = ( mInplaceHead + 1 ) & ( mInplaceTasks.size() - 1 );
+        mNumOfInplaceTasks--;
+        result = true;
+      }
+    mTaskMutex.unlock();
+  }
+
+  return result;
 }
 
+size_t ThreadPool::TaskPool::getDepth(void)
+{
+  size_t result;
+
+  mTaskMutex.lock();
+    result = mTasks.size() + mNumOfInplaceTasks;
+  mTaskMutex.unlock();
+
+  return result;
+}
 
-ThreadPool::ThreadExector::ThreadExector(std::shared_ptr<TaskPool> pTaskPool) : mTaskPool( pTaskPool ), mStopping( false )
+void ThreadPool::TaskPool::updateMaxDepth(size_t nDepth)
 {
+  size_t nMaxDepth = mMaxDepth.load( std::memory_order_relaxed );
+  while( nDepth > nMaxDepth && !mMaxDepth.compare_exchange_weak( nMaxDepth, nDepth, std::memory_order_relaxed ) );
+}
+
+void ThreadPool::TaskPool::waitForTask(std::atomic<bool>& bStopping)
+{
+  std::unique_lock<std::mutex> lock( mTaskMutex );
+  mNumOfWaiters++;
+  mTaskCondition.wait( lock, [&]{ return bStopping || !isEmpty() || mNumOfLocalTasks.load() > 0; } );
+  mNumOfWaiters--;
+}
+
+void ThreadPool::TaskPool::onLocalTaskPushed(void)
+{
+  // seq_cst pairs with mNumOfWaiters++ in waitForTask() : either the waiter sees the task or we see the waiter
+  mNumOfLocalTasks.fetch_add( 1 );
+  if( mNumOfWaiters.load() ){
+    mTaskMutex.lock();
+    mTaskMutex.unlock();
+    mTaskCondition.notify_one();
+  }
+}
+
+void ThreadPool::TaskPool::notifyWaiter(void)
+{
+  // the waiter is registered under mTaskMutex, so skipping the notify is safe when nobody is parked
+  if( mNumOfWaiters ){
+    mTaskCondition.notify_one();
+  }
+}
+
+void ThreadPool::TaskPool::notifyWaiters(size_t nNumOfTasks)
+{
+  size_t nNumOfWaiters = mNumOfWaiters;
+  if( nNumOfWaiters ){
+    if( nNumOfTasks >= nNumOfWaiters ){
+      mTaskCondition.notify_all();
+    } else {
+      for( size_t i = 0; i < nNumOfTasks; i++ ){
+        mTaskCondition.notify_one();
+      }
+    }
+  }
+}
+
+void ThreadPool::TaskPool::wakeUpAll(void)
+{
+  // ensure the waiter either sees the caller's stop request or is already parked
+  mTaskMutex.lock();
+  mTaskMutex.unlock();
+  mTaskCondition.notify_all();
+}
+
+
+ThreadPool::ThreadExector::ThreadExector(std::shared_ptr<TaskPool> pTaskPool, std::shared_ptr<WorkStealingGroup> pWorkStealing, int nIndex) : mTaskPool( pTaskPool ), mStopping( false ), mSpinCount( SPIN_COUNT_MIN ), mInplaceFirst( true ), mBatchHead( 0 ), mBatchSize( 1 ), mWorkStealing( pWorkStealing ), mIndex( nIndex ), mRandom( nIndex + 1 ), mMetricsEnabled( false ), mNumOfExecutedTasks( 0 ), mBusyTimeNsec( 0 ), mMetricsStartTimeNsec( 0 )
+{
+  if( mWorkStealing ){
+    mLocalTasks = mWorkStealing->getDeque( nIndex );
+  }
 }
 
 ThreadPool::ThreadExector::~ThreadExector()
@@ -81,22 +297,73 @@ void ThreadPool::ThreadExector::execute(void)
   }
 }
 
+bool ThreadPool::ThreadExector::setAffinity(const std::vector<int>& cpus)
+{
+  bool result = true;
+
+  mAffinityMutex.lock();
+    mCpus = cpus;
+    if( mThread ){
+      result = applyAffinity( mThread->native_handle() );
+    }
+  mAffinityMutex.unlock();
+
+  return result;
+}
+
+bool ThreadPool::ThreadExector::applyAffinity(std::thread::native_handle_type thread)
+{
+  bool result = false;
+#if defined(__linux__)
+  // the empty mCpus releases the running worker to the available CPUs
+  std::vector<int> cpus = mCpus.empty() ? ThreadPool::getAvailableCpus() : mCpus;
+  cpu_set_t cpuset;
+  CPU_ZERO( &cpuset );
+  for( int nCpu : cpus ){
+    if( nCpu >= 0 && nCpu < CPU_SETSIZE ){
+      CPU_SET( nCpu, &cpuset );
+    }
+  }
+  result = ( pthread_setaffinity_np( thread, sizeof( cpuset ), &cpuset ) == 0 );
+#endif
+  return result;
+}
+
 void ThreadPool::ThreadExector::terminate(void)
 {
   if( mThread ){
     mStopping = true;
-    if( mCurrentRunningTask ){
-      std::shared_ptr<Task> pFullTask = std::dynamic_pointer_cast<Task>( mCurrentRunningTask );
+    std::shared_ptr<ITask> pCurrentTask = getCurrentRunningTask();
+    if( pCurrentTask ){
+      Task* pFullTask = pCurrentTask->getTask();
       if( pFullTask ){
         pFullTask->cancel();
       }
     }
+    if( mTaskPool ){
+      mTaskPool->wakeUpAll();
+    }
     if( mThread->joinable() ){
+      if( mThread->get_id() == std::this_thread::get_id() ){
+        // terminated from the running task : the thread exits after the task and _execute() keeps this alive until then
+        mThread->detach();
+        mThread.reset();
+        return;
+      }
       mThread->join();
     }
     mStopping = false;
   }
-  mCurrentRunningTask.reset();
+  setCurrentRunningTask( nullptr );
+  std::vector<std::shared_ptr<ITask>> abandonedTasks;
+  mBatchMutex.lock();
+    for( ; mBatchHead < mBatchTasks.size(); mBatchHead++ ){
+      abandonedTasks.push_back( std::move( mBatchTasks[ mBatchHead ] ) );
+    }
+    mBatchTasks.clear();
+    mBatchHead = 0;
+  mBatchMutex.unlock();
+  TaskPool::abandonTasks( abandonedTasks );
   mTaskPool.reset();
   mThread.reset();
 }
@@ -104,48 +371,309 @@ void ThreadPool::ThreadExector::terminate(void)
 void ThreadPool::ThreadExector::_execute( std::shared_ptr<ThreadExector> pThis )
 {
   if( pThis ){
+#if defined(__linux__)
+    // pin itself before the first task
+    pThis->mAffinityMutex.lock();
+      if( !pThis->mCpus.empty() ){
+        pThis->applyAffinity( pthread_self() );
+      }
+    pThis->mAffinityMutex.unlock();
+#endif
+    gCurrentExector = pThis.get();
     pThis->onExecute();
+    gCurrentExector = nullptr;
+  }
+}
+
+ThreadPool::ThreadExector* ThreadPool::ThreadExector::getCurrentExector(void)
+{
+  return gCurrentExector;
+}
+
+bool ThreadPool::ThreadExector::addLocalTask(std::shared_ptr<WorkStealingGroup> pWorkStealing, std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  if( mLocalTasks && ( mWorkStealing == pWorkStealing ) ){
+    result = mWorkStealing->push( mLocalTasks, pTask );
+    if( result && mTaskPool ){
+      mTaskPool->onLocalTaskPushed();
+    }
   }
+
+  return result;
+}
+
+std::shared_ptr<ITask> ThreadPool::ThreadExector::getNextTask(void)
+{
+  std::shared_ptr<ITask> result;
+
+  if( mLocalTasks ){
+    // own deque at first for the locality, the shared pool for the external tasks, and then the others' deques
+    bool bLocal = true;
+    result = mLocalTasks->pop();
+    if( !result ){
+      result = mTaskPool->dequeue();
+      bLocal = false;
+      if( !result ){
+        result = mWorkStealing->steal( mIndex, mRandom );
+        bLocal = true;
+      }
+    }
+    // the shared TaskPool skips the cancelled task by itself
+    if( result && bLocal ){
+      mTaskPool->onLocalTaskTaken();
+      if( mWorkStealing->isCancelled( result ) ){
+        result.reset();
+      }
+    }
+  } else if( mBatchSize > 1 ){
+    result = getNextBatchTask();
+  } else {
+    result = mTaskPool->dequeue();
+  }
+
+  return result;
+}
+
+std::shared_ptr<ITask> ThreadPool::ThreadExector::getNextBatchTask(void)
+{
+  std::shared_ptr<ITask> result;
+
+  mBatchMutex.lock();
+    if( mBatchHead >= mBatchTasks.size() ){
+      mBatchTasks.clear();
+      mBatchHead = 0;
+      mTaskPool->dequeueBatch( mBatchTasks, mBatchSize );
+    }
+    // the cancelled task is cleared by cancelTaskIfRunning()
+    while( !result && mBatchHead < mBatchTasks.size() ){
+      result = std::move( mBatchTasks[ mBatchHead++ ] );
+    }
+  mBatchMutex.unlock();
+
+  return result;
+}
+
+void ThreadPool::ThreadExector::recordExecution(bool bMeasured, std::chrono::steady_clock::time_point startTime)
+{
+  if( bMeasured ){
+    std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startTime;
+    mExecutionLatency.record( duration );
+    mBusyTimeNsec.fetch_add( duration.count(), std::memory_order_relaxed );
+  }
+  // release : the reader seeing the count sees the latency recorded above
+  mNumOfExecutedTasks.fetch_add( 1, std::memory_order_release );
+}
+
+bool ThreadPool::ThreadExector::executeInplaceTask(void)
+{
+  bool result = mTaskPool->dequeueInplace( mCurrentInplaceTask );
+
+  if( result ){
+    bool bMeasured = mMetricsEnabled.load( std::memory_order_relaxed );
+    std::chrono::steady_clock::time_point startTime = bMeasured ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    mCurrentInplaceTask();
+    mCurrentInplaceTask.reset();
+
+    recordExecution( bMeasured, startTime );
+  }
+
+  return result;
+}
+
+bool ThreadPool::ThreadExector::executeNextTask(void)
+{
+  std::shared_ptr<ITask> pTask = getNextTask();
+  bool result = ( pTask != nullptr );
+
+  if( result ){
+    setCurrentRunningTask( std::move( pTask ) );
+    executeTask();
+  }
+
+  return result;
+}
+
+void ThreadPool::ThreadExector::executeTask(void)
+{
+  bool bMeasured = mMetricsEnabled.load( std::memory_order_relaxed );
+  std::chrono::steady_clock::time_point startTime;
+  if( bMeasured ){
+    startTime = std::chrono::steady_clock::now();
+    // the task added before enableMetrics() has no enqueue time
+    std::chrono::steady_clock::time_point enqueueTime = mCurrentRunningTask->getEnqueueTime();
+    if( enqueueTime.time_since_epoch().count() ){
+      mWaitLatency.record( startTime - enqueueTime );
+      mCurrentRunningTask->setEnqueueTime( std::chrono::steady_clock::time_point() );
+    }
+  }
+
+  Task* pFullTask = mCurrentRunningTask->getTask();
+  if( pFullTask ){
+    pFullTask->execute();
+  } else {
+    mCurrentRunningTask->onExecute();
+    mCurrentRunningTask->onComplete();
+    setCurrentRunningTask( nullptr );
+  }
+
+  recordExecution( bMeasured, startTime );
 }
 
 void ThreadPool::ThreadExector::onExecute(void)
 {
+  int nSpin = 0;
+
   while( !mStopping && mTaskPool ){
-    mCurrentRunningTask = mTaskPool->dequeue();
-    if( mCurrentRunningTask ){
-      std::shared_ptr<Task> pFullTask = std::dynamic_pointer_cast<Task>( mCurrentRunningTask );
-      if( pFullTask ){
-        pFullTask->execute();
-      } else {
-        mCurrentRunningTask->onExecute();
-        mCurrentRunningTask->onComplete();
-        mCurrentRunningTask.reset();
+    bool bExecuted = mInplaceFirst ? ( executeInplaceTask() || executeNextTask() ) : ( executeNextTask() || executeInplaceTask() );
+    mInplaceFirst = !mInplaceFirst;
+    if( bExecuted ){
+      if( nSpin ){
+        // the task arrived while spinning, so allow longer spin next time
+        mSpinCount = std::min( mSpinCount * 2, SPIN_COUNT_MAX );
       }
-    } else {
+      nSpin = 0;
+    } else if( nSpin < mSpinCount ){
+      nSpin++;
       std::this_thread::yield();
+    } else {
+      // spinning didn't pay off, then park without consuming CPU until addTask() wakes up
+      mSpinCount = std::max( mSpinCount / 2, SPIN_COUNT_MIN );
+      nSpin = 0;
+      mTaskPool->waitForTask( mStopping );
     }
   }
 }
 
-void ThreadPool::ThreadExector::cancelTaskIfRunning(std::shared_ptr<ITask> pTask)
+bool ThreadPool::ThreadExector::cancelTaskIfRunning(std::shared_ptr<ITask> pTask)
 {
-  if( mCurrentRunningTask == pTask ){
-    std::shared_ptr<Task> pFullTask = std::dynamic_pointer_cast<Task>( mCurrentRunningTask );
+  bool result = false;
+
+  if( pTask && mBatchSize > 1 ){
+    mBatchMutex.lock();
+      for( size_t i = mBatchHead; i < mBatchTasks.size(); i++ ){
+        if( mBatchTasks[i] == pTask ){
+          mBatchTasks[i].reset();
+          result = true;
+        }
+      }
+    mBatchMutex.unlock();
+  }
+  if( pTask && getCurrentRunningTask() == pTask ){
+    Task* pFullTask = pTask->getTask();
     if( pFullTask ){
       pFullTask->cancel();
     }
   }
+
+  return result;
+}
+
+void ThreadPool::ThreadExector::setCurrentRunningTask(std::shared_ptr<ITask> pTask)
+{
+  // release the previous task out of the lock
+  std::shared_ptr<ITask> pPreviousTask;
+  mRunningTaskMutex.lock();
+    pPreviousTask = std::move( mCurrentRunningTask );
+    mCurrentRunningTask = std::move( pTask );
+  mRunningTaskMutex.unlock();
+}
+
+std::shared_ptr<ITask> ThreadPool::ThreadExector::getCurrentRunningTask(void)
+{
+  std::lock_guard<std::mutex> lock( mRunningTaskMutex );
+  return mCurrentRunningTask;
+}
+
+void ThreadPool::ThreadExector::enableMetrics(bool bEnabled)
+{
+  if( bEnabled != mMetricsEnabled ){
+    mMetricsStartTimeNsec = bEnabled ? std::chrono::steady_clock::now().time_since_epoch().count() : 0;
+    mMetricsEnabled = bEnabled;
+  }
 }
 
-ThreadPool::ThreadPool( int nNumOfThreads ) : mMaxThreads( nNumOfThreads )
+void ThreadPool::ThreadExector::collectMetrics(Metrics& metrics)
 {
-  mTaskPool = std::make_shared<ThreadPool::TaskPool>();
+  uint64_t nExecutedTasks = mNumOfExecutedTasks.load( std::memory_order_acquire );
+  metrics.nExecutedTasks += nExecutedTasks;
+  metrics.executedTasksPerWorker.push_back( nExecutedTasks );
+
+  int64_t nStartTimeNsec = mMetricsStartTimeNsec.load( std::memory_order_relaxed );
+  if( nStartTimeNsec ){
+    std::chrono::nanoseconds busyTime( mBusyTimeNsec.load( std::memory_order_relaxed ) );
+    std::chrono::nanoseconds elapsedTime( std::chrono::steady_clock::now().time_since_epoch().count() - nStartTimeNsec );
+    metrics.busyTime += busyTime;
+    // the running task's time is counted as idle until it finishes
+    metrics.idleTime += ( elapsedTime > busyTime ) ? ( elapsedTime - busyTime ) : std::chrono::nanoseconds( 0 );
+  }
+
+  metrics.waitLatency.merge( mWaitLatency.getSnapshot() );
+  metrics.executionLatency.merge( mExecutionLatency.getSnapshot() );
+}
 
+void ThreadPool::ThreadExector::resetMetrics(void)
+{
+  mNumOfExecutedTasks = 0;
+  mBusyTimeNsec = 0;
+  if( mMetricsEnabled ){
+    mMetricsStartTimeNsec = std::chrono::steady_clock::now().time_since_epoch().count();
+  }
+  mWaitLatency.reset();
+  mExecutionLatency.reset();
+}
+
+ThreadPool::ThreadPool( int nNumOfThreads ) : ThreadPool( nNumOfThreads, std::make_shared<ThreadPool::TaskPool>() )
+{
+}
+
+ThreadPool::ThreadPool( int nNumOfThreads, std::shared_ptr<TaskPool> pTaskPool ) : mMaxThreads( nNumOfThreads ), mTaskPool( pTaskPool ), mMetricsEnabled( false )
+{
   for( int i = 0; i < nNumOfThreads; i++ ){
     mThreads.push_back( std::make_shared<ThreadPool::ThreadExector>( mTaskPool ) );
   }
 }
 
+ThreadPool::ThreadPool( int nNumOfThreads, bool bWorkStealing ) : mMaxThreads( nNumOfThreads ), mTaskPool( std::make_shared<ThreadPool::TaskPool>() ), mMetricsEnabled( false )
+{
+  if( bWorkStealing ){
+    mWorkStealing = std::make_shared<WorkStealingGroup>( nNumOfThreads );
+  }
+  for( int i = 0; i < nNumOfThreads; i++ ){
+    mThreads.push_back( std::make_shared<ThreadPool::ThreadExector>( mTaskPool, mWorkStealing, i ) );
+  }
+}
+
+ThreadPool::ThreadPool( const Config& config ) : mMaxThreads( config.nNumOfThreads ), mTaskPool( ( config.pTaskPool && !config.bWorkStealing ) ? config.pTaskPool : std::make_shared<ThreadPool::TaskPool>() ), mMetricsEnabled( false )
+{
+  if( config.bWorkStealing ){
+    mWorkStealing = std::make_shared<WorkStealingGroup>( config.nNumOfThreads );
+  }
+  std::vector<int> cpus = config.cpus.empty() ? getAvailableCpus() : config.cpus;
+  for( int i = 0; i < config.nNumOfThreads; i++ ){
+    std::shared_ptr<ThreadExector> pThread = std::make_shared<ThreadPool::ThreadExector>( mTaskPool, mWorkStealing, i );
+    pThread->setBatchSize( config.nDequeueBatchSize );
+    switch( config.affinityPolicy ){
+      case AFFINITY_ROUND_ROBIN:
+        pThread->setAffinity( { cpus[ i % cpus.size() ] } );
+        break;
+      case AFFINITY_CPUSET:
+        pThread->setAffinity( cpus );
+        break;
+      case AFFINITY_EXPLICIT:
+        if( i < (int)config.workerCpus.size() ){
+          pThread->setAffinity( config.workerCpus[i] );
+        }
+        break;
+      default:
+        break;
+    }
+    mThreads.push_back( pThread );
+  }
+}
+
 ThreadPool::~ThreadPool()
 {
   terminate();
@@ -154,18 +682,145 @@ ThreadPool::~ThreadPool()
 void ThreadPool::addTask(std::shared_ptr<ITask> pTask)
 {
   if( mTaskPool ){
-    mTaskPool->enqueue( pTask );
+    if( pTask && mMetricsEnabled.load( std::memory_order_relaxed ) ){
+      pTask->setEnqueueTime( std::chrono::steady_clock::now() );
+    }
+    bool bAdded = false;
+    if( mWorkStealing ){
+      mWorkStealing->resume( pTask );
+      // the task spawned by our worker stays in its own deque unless the parked worker should take it
+      ThreadExector* pExector = ThreadExector::getCurrentExector();
+      if( pExector && !mTaskPool->hasWaiter() ){
+        bAdded = pExector->addLocalTask( mWorkStealing, pTask );
+      }
+    }
+    if( !bAdded ){
+      mTaskPool->enqueue( pTask );
+    }
+  } else if( pTask ){
+    // the terminated pool never runs it
+    pTask->onAbandon();
+  }
+}
+
+void ThreadPool::addTask(std::shared_ptr<ITask> pTask, std::chrono::steady_clock::time_point deadline)
+{
+  if( pTask ){
+    pTask->setDeadline( deadline );
+    addTask( pTask );
+  }
+}
+
+void ThreadPool::addTask(InplaceTask&& task)
+{
+  if( mTaskPool ){
+    mTaskPool->enqueueInplace( std::move( task ) );
+  }
+}
+
+void ThreadPool::addTasks(const std::vector<std::shared_ptr<ITask>>& tasks)
+{
+  if( mTaskPool && !tasks.empty() ){
+    bool bMetricsEnabled = mMetricsEnabled.load( std::memory_order_relaxed );
+    std::chrono::steady_clock::time_point now = bMetricsEnabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    for( auto& pTask : tasks ){
+      // the null task is skipped by enqueueBatch()
+      if( !pTask ){
+        continue;
+      }
+      if( bMetricsEnabled ){
+        pTask->setEnqueueTime( now );
+      }
+      if( mWorkStealing ){
+        mWorkStealing->resume( pTask );
+      }
+    }
+    mTaskPool->enqueueBatch( tasks );
+  } else if( !mTaskPool ){
+    std::vector<std::shared_ptr<ITask>> abandonedTasks( tasks );
+    TaskPool::abandonTasks( abandonedTasks );
+  }
+}
+
+void ThreadPool::setDequeueBatchSize(size_t nBatchSize)
+{
+  for( auto& pThread : mThreads ){
+    pThread->setBatchSize( nBatchSize );
   }
 }
 
 void ThreadPool::canceTask(std::shared_ptr<ITask> pTask)
 {
   if( mTaskPool ){
-    mTaskPool->erase( pTask );
+    bool bRemoved = mTaskPool->erase( pTask );
+    if( mWorkStealing ){
+      bRemoved = mWorkStealing->cancel( pTask ) || bRemoved;
+    }
     for( auto& pThread : mThreads ){
-      pThread->cancelTaskIfRunning( pTask );
+      bRemoved = pThread->cancelTaskIfRunning( pTask ) || bRemoved;
+    }
+    // only the task taken out of the pool is abandoned. the running or unknown one isn't
+    if( bRemoved ){
+      pTask->onAbandon();
+    }
+  }
+}
+
+void ThreadPool::enableMetrics(bool bEnabled)
+{
+  mMetricsEnabled = bEnabled;
+  for( auto& pThread : mThreads ){
+    pThread->enableMetrics( bEnabled );
+  }
+}
+
+ThreadPool::Metrics ThreadPool::getMetrics(void)
+{
+  Metrics result;
+
+  result.nNumOfThreads = mThreads.size();
+  for( auto& pThread : mThreads ){
+    pThread->collectMetrics( result );
+  }
+  if( mTaskPool ){
+    result.nQueueDepth = mTaskPool->getDepth();
+    result.nMaxQueueDepth = mTaskPool->getMaxDepth();
+    result.nDeadlineMisses = mTaskPool->getNumOfDeadlineMisses();
+  }
+
+  return result;
+}
+
+void ThreadPool::resetMetrics(void)
+{
+  for( auto& pThread : mThreads ){
+    pThread->resetMetrics();
+  }
+  if( mTaskPool ){
+    mTaskPool->resetMaxDepth();
+  }
+}
+
+std::vector<int> ThreadPool::getAvailableCpus(void)
+{
+  std::vector<int> result;
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO( &cpuset );
+  if( sched_getaffinity( 0, sizeof( cpuset ), &cpuset ) == 0 ){
+    for( int i = 0; i < CPU_SETSIZE; i++ ){
+      if( CPU_ISSET( i, &cpuset ) ){
+        result.push_back( i );
+      }
     }
   }
+#endif
+  if( result.empty() ){
+    for( int i = 0, nNumOfCpus = std::max( 1u, std::thread::hardware_concurrency() ); i < nNumOfCpus; i++ ){
+      result.push_back( i );
+    }
+  }
+  return result;
 }
 
 void ThreadPool::execute(void)
@@ -184,6 +839,10 @@ void ThreadPool::terminate(void)
       pThread->terminate();
     }
     mThreads.clear();
+    // the tasks in the shared TaskPool are abandoned when it's destroyed
+    if( mWorkStealing ){
+      mWorkStealing->clear();
+    }
     mTaskPool.reset();
   }
 }
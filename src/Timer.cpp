@@ -16,32 +16,64 @@
 
 #include "Timer.hpp"
 
-Timer::Timer(int nDelayMsec, bool bRepeat) : mDelayMsec( nDelayMsec ), mRepeat( bRepeat )
+Timer::Timer(int nDelayMsec, bool bRepeat) : Timer( std::chrono::milliseconds( nDelayMsec ), bRepeat )
 {
-  mTaskManRefCounter++;
+
+}
+
+Timer::Timer(std::chrono::nanoseconds delay, bool bRepeat) : mDelay( delay ), mRepeat( bRepeat )
+{
+  mSharedMutex.lock();
+    mTaskManRefCounter++;
+  mSharedMutex.unlock();
 }
 
 Timer::~Timer()
 {
-  mTaskManRefCounter--;
-  if( mTaskManRefCounter<=0 ){
-    mPeriodicTaskManager.reset();
-    mThreadPool.reset();
-    mTaskManRefCounter = 0;
+  std::shared_ptr<TimingWheel> pTimingWheel;
+  std::shared_ptr<PeriodicTaskManager> pPeriodicTaskManager;
+  std::shared_ptr<ThreadPool> pThreadPool;
+
+  mSharedMutex.lock();
+    mTaskManRefCounter--;
+    if( mTaskManRefCounter<=0 ){
+      pTimingWheel.swap( mTimingWheel );
+      pPeriodicTaskManager.swap( mPeriodicTaskManager );
+      pThreadPool.swap( mThreadPool );
+      mTaskManRefCounter = 0;
+    }
+  mSharedMutex.unlock();
+
+  // tear down out of the lock : the next Timer creates the new ones meanwhile.
+  // the last Timer may be released on the wheel's or the pool's own thread, and their terminate() detaches it
+  if( pTimingWheel ){
+    pTimingWheel->terminate();
+  }
+  if( pPeriodicTaskManager ){
+    pPeriodicTaskManager->terminate();
+  }
+  if( pThreadPool ){
+    pThreadPool->terminate();
   }
 }
 
-std::shared_ptr<IPeriodicTaskManager> Timer::getTaskManager(void)
+std::shared_ptr<TimingWheel> Timer::getTimingWheel(void)
 {
-  if( !mPeriodicTaskManager ){
-    mPeriodicTaskManager = std::make_shared<PeriodicTaskManager>();
+  // the caller is the living Timer, then the pool isn't torn down between them
+  std::shared_ptr<ThreadPool> pThreadPool = getThreadPool();
+
+  std::lock_guard<std::mutex> lock( mSharedMutex );
+  if( !mTimingWheel ){
+    mTimingWheel = std::make_shared<TimingWheel>( pThreadPool );
+    mTimingWheel->execute();
   }
 
-  return mPeriodicTaskManager;
+  return mTimingWheel;
 }
 
 std::shared_ptr<ThreadPool> Timer::getThreadPool(void)
 {
+  std::lock_guard<std::mutex> lock( mSharedMutex );
   if( !mThreadPool ){
     mThreadPool = std::make_shared<ThreadPool>();
   }
@@ -49,41 +81,61 @@ std::shared_ptr<ThreadPool> Timer::getThreadPool(void)
   return mThreadPool;
 }
 
+std::shared_ptr<PeriodicTaskManager> Timer::getPeriodicTaskManager(void)
+{
+  std::lock_guard<std::mutex> lock( mSharedMutex );
+  if( !mPeriodicTaskManager ){
+    mPeriodicTaskManager = std::make_shared<PeriodicTaskManager>();
+  }
 
-void Timer::schedule(void)
+  return mPeriodicTaskManager;
+}
+
+bool Timer::isHighResolution(void)
 {
+  return mRepeat && ( mDelay < TimingWheel::DEFAULT_TICK );
+}
 
-  if( mRepeat ){
-    // periodic task (repeated task )
-    std::shared_ptr<IPeriodicTaskManager> pTaskMan = getTaskManager();
-    if( pTaskMan ){
-      pTaskMan->scheduleRepeat( shared_from_this(), mDelayMsec );
-      pTaskMan->execute();
-    }
-  } else {
-    // non-periodic task (just delayed one shot task )
-    std::shared_ptr<ThreadPool> pThreadPool = getThreadPool();
-    if( pThreadPool ){
-      pThreadPool->addTask( std::make_shared<Timer::DelayedTask>( shared_from_this(), mDelayMsec ) );
-      pThreadPool->execute();
+
+void Timer::schedule(void)
+{
+  if( isHighResolution() ){
+    std::shared_ptr<PeriodicTaskManager> pPeriodicTaskManager = getPeriodicTaskManager();
+    if( pPeriodicTaskManager ){
+      pPeriodicTaskManager->cancelScheduleRepeat( shared_from_this() );
+      pPeriodicTaskManager->scheduleRepeat( shared_from_this(), mDelay );
+      pPeriodicTaskManager->execute();
     }
+    return;
+  }
+
+  // the timing wheel keeps the waiting timer, and only the expired timer runs on the thread pool
+  std::shared_ptr<TimingWheel> pTimingWheel = getTimingWheel();
+  std::shared_ptr<ThreadPool> pThreadPool = getThreadPool();
+  if( pTimingWheel && pThreadPool ){
+    // periodic task (repeated task ) or non-periodic task (just delayed one shot task )
+    pTimingWheel->schedule( shared_from_this(), mDelay, mRepeat ? mDelay : std::chrono::nanoseconds( 0 ) );
+    pThreadPool->execute();
   }
 }
 
 void Timer::cancelSchedule(void)
 {
-  if( mRepeat ){
-    // periodic task (repeated task )
-    std::shared_ptr<IPeriodicTaskManager> pTaskMan = getTaskManager();
-    if( pTaskMan ){
-      pTaskMan->cancelScheduleRepeat( shared_from_this() );
-    }
-  } else {
-    // non-periodic task (just delayed one shot task )
-    std::shared_ptr<ThreadPool> pThreadPool = getThreadPool();
-    if( pThreadPool ){
-      pThreadPool->canceTask( shared_from_this() );
-    }
+  // cancel only on the existing ones. never create them to cancel
+  mSharedMutex.lock();
+    std::shared_ptr<TimingWheel> pTimingWheel = mTimingWheel;
+    std::shared_ptr<ThreadPool> pThreadPool = mThreadPool;
+    std::shared_ptr<PeriodicTaskManager> pPeriodicTaskManager = mPeriodicTaskManager;
+  mSharedMutex.unlock();
+
+  if( pPeriodicTaskManager ){
+    pPeriodicTaskManager->cancelScheduleRepeat( shared_from_this() );
+  }
+  if( pTimingWheel ){
+    pTimingWheel->cancel( shared_from_this() );
+  }
+  if( pThreadPool ){
+    pThreadPool->canceTask( shared_from_this() );
   }
 }
 
@@ -93,6 +145,11 @@ LambdaTimer::LambdaTimer(TASK_LAMBDA lambda, int nDelayMsec, bool bRepeat) : Tim
 
 }
 
+LambdaTimer::LambdaTimer(TASK_LAMBDA lambda, std::chrono::nanoseconds delay, bool bRepeat) : Timer( delay, bRepeat ), mLambdaFunc( lambda )
+{
+
+}
+
 LambdaTimer::~LambdaTimer(void)
 {
 
@@ -102,3 +159,14 @@ void LambdaTimer::onExecute(void)
 {
   mLambdaFunc( shared_from_this() );
 }
+
+#if ASYNC_TASK_COROUTINE
+void Timer::DelayAwaiter::await_suspend(ASYNC_TASK_COROUTINE_NS::coroutine_handle<> handle)
+{
+  // the wheel keeps the one shot timer until it fires, then the timer releases itself after the resume
+  std::shared_ptr<LambdaTimer> pTimer = std::make_shared<LambdaTimer>( [handle](std::shared_ptr<Task> pTask){
+    handle.resume();
+  }, mDelay, false );
+  pTimer->schedule();
+}
+#endif /* ASYNC_TASK_COROUTINE */
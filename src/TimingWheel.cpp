@@ -0,0 +1,244 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "TimingWheel.hpp"
+
+TimingWheel::TimingWheel(std::shared_ptr<ThreadPool> pThreadPool, std::chrono::microseconds tick) : mThreadPool( pThreadPool ), mStartTime( std::chrono::steady_clock::now() ), mTick( tick ), mCurrentTick( 0 ), mStopping( false )
+{
+  if( mTick.count() <= 0 ){
+    mTick = std::chrono::microseconds( 1 );
+  }
+}
+
+TimingWheel::~TimingWheel()
+{
+  terminate();
+}
+
+uint64_t TimingWheel::getNowTick(void)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - mStartTime ).count() / mTick.count();
+}
+
+uint64_t TimingWheel::getDeadlineTick(std::chrono::nanoseconds delay)
+{
+  // round up not to expire earlier than the delay
+  int64_t nTick = std::chrono::nanoseconds( mTick ).count();
+  std::chrono::nanoseconds deadline = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - mStartTime ) + delay;
+  uint64_t result = ( deadline.count() + nTick - 1 ) / nTick;
+  return ( result > mCurrentTick ) ? result : ( mCurrentTick + 1 );
+}
+
+uint64_t TimingWheel::toTicks(std::chrono::nanoseconds duration)
+{
+  int64_t nTick = std::chrono::nanoseconds( mTick ).count();
+  uint64_t result = ( duration.count() + nTick - 1 ) / nTick;
+  return ( duration.count() > 0 && result ) ? result : 1;
+}
+
+void TimingWheel::place(SLOT* pSlot, SLOT::iterator it)
+{
+  static const uint64_t MAX_RANGE = 1ull << ( SLOT_BITS * NUM_OF_LEVELS );
+
+  uint64_t nDelta = ( it->nDeadline > mCurrentTick ) ? ( it->nDeadline - mCurrentTick ) : 0;
+  // the farther deadline than the wheel covers is parked at the last slot and placed again when cascaded
+  uint64_t nTarget = ( nDelta < MAX_RANGE ) ? it->nDeadline : ( mCurrentTick + MAX_RANGE - 1 );
+
+  int nLevel = 0;
+  while( ( nLevel < NUM_OF_LEVELS - 1 ) && ( nDelta >= ( 1ull << ( SLOT_BITS * ( nLevel + 1 ) ) ) ) ){
+    nLevel++;
+  }
+  int nSlot = ( nTarget >> ( SLOT_BITS * nLevel ) ) & ( NUM_OF_SLOTS - 1 );
+
+  it->nLevel = nLevel;
+  it->nSlot = nSlot;
+  mSlots[nLevel][nSlot].splice( mSlots[nLevel][nSlot].end(), *pSlot, it );
+}
+
+void TimingWheel::cascade(int nLevel)
+{
+  SLOT& slot = mSlots[nLevel][ ( mCurrentTick >> ( SLOT_BITS * nLevel ) ) & ( NUM_OF_SLOTS - 1 ) ];
+  while( !slot.empty() ){
+    place( &slot, slot.begin() );
+  }
+}
+
+void TimingWheel::advance(std::vector<TimerEntry>& expiredTasks)
+{
+  mCurrentTick++;
+
+  // the upper level's slot reaching the lower level's range is redistributed
+  for( int nLevel = 1; nLevel < NUM_OF_LEVELS; nLevel++ ){
+    if( mCurrentTick & ( ( 1ull << ( SLOT_BITS * nLevel ) ) - 1 ) ){
+      break;
+    }
+    cascade( nLevel );
+  }
+
+  SLOT& slot = mSlots[0][ mCurrentTick & ( NUM_OF_SLOTS - 1 ) ];
+  while( !slot.empty() ){
+    SLOT::iterator it = slot.begin();
+    expiredTasks.push_back( *it );
+    if( it->nPeriod ){
+      // the next deadline is based on the previous deadline, then it doesn't drift
+      it->nDeadline += it->nPeriod;
+      place( &slot, it );
+    } else {
+      mEntries.erase( it->pTask.get() );
+      slot.erase( it );
+    }
+  }
+}
+
+std::chrono::steady_clock::time_point TimingWheel::getNextWakeUpTime(void)
+{
+  // sleep until the next occupied slot of the lowest level or the next cascade
+  uint64_t nBoundary = ( mCurrentTick | ( NUM_OF_SLOTS - 1 ) ) + 1;
+  uint64_t nNextTick = nBoundary;
+
+  for( uint64_t nTick = mCurrentTick + 1; nTick < nBoundary; nTick++ ){
+    if( !mSlots[0][ nTick & ( NUM_OF_SLOTS - 1 ) ].empty() ){
+      nNextTick = nTick;
+      break;
+    }
+  }
+
+  return mStartTime + mTick * nNextTick;
+}
+
+void TimingWheel::dispatch(std::vector<TimerEntry>& expiredTasks)
+{
+  for( auto& entry : expiredTasks ){
+    // the previous expiry of the repeated task is still queued or running, then this expiry is coalesced.
+    // the one shot is always dispatched since it may be re-armed by its own running callback
+    if( mThreadPool && ( !entry.nPeriod || entry.pTask->tryMarkInFlight() ) ){
+      mThreadPool->addTask( entry.pTask );
+    }
+  }
+  expiredTasks.clear();
+}
+
+void TimingWheel::_execute(std::shared_ptr<TimingWheel> pThis)
+{
+  if( pThis ){
+    pThis->onExecute();
+  }
+}
+
+void TimingWheel::onExecute(void)
+{
+  std::vector<TimerEntry> expiredTasks;
+  std::unique_lock<std::mutex> lock( mMutex );
+
+  while( !mStopping ){
+    uint64_t nNowTick = getNowTick();
+    while( mCurrentTick < nNowTick ){
+      advance( expiredTasks );
+    }
+
+    if( !expiredTasks.empty() ){
+      lock.unlock();
+      dispatch( expiredTasks );
+      lock.lock();
+    } else if( mEntries.empty() ){
+      mCondition.wait( lock );
+    } else {
+      mCondition.wait_until( lock, getNextWakeUpTime() );
+    }
+  }
+}
+
+void TimingWheel::schedule(std::shared_ptr<Task> pTask, int nDelayMsec, int nPeriodMsec)
+{
+  schedule( pTask, std::chrono::milliseconds( nDelayMsec ), std::chrono::milliseconds( nPeriodMsec ) );
+}
+
+void TimingWheel::schedule(std::shared_ptr<Task> pTask, std::chrono::nanoseconds delay, std::chrono::nanoseconds period)
+{
+  if( pTask ){
+    cancel( pTask );
+
+    mMutex.lock();
+      SLOT newEntry;
+      newEntry.push_back( { pTask, getDeadlineTick( delay ), ( period.count() > 0 ) ? toTicks( period ) : 0, 0, 0 } );
+      SLOT::iterator it = newEntry.begin();
+      place( &newEntry, it );
+      mEntries.insert_or_assign( pTask.get(), it );
+    mMutex.unlock();
+
+    mCondition.notify_one();
+  }
+}
+
+void TimingWheel::cancel(std::shared_ptr<Task> pTask)
+{
+  SLOT removedEntry;
+
+  mMutex.lock();
+    auto itEntry = mEntries.find( pTask.get() );
+    if( itEntry != mEntries.end() ){
+      SLOT::iterator it = itEntry->second;
+      removedEntry.splice( removedEntry.end(), mSlots[it->nLevel][it->nSlot], it );
+      mEntries.erase( itEntry );
+    }
+  mMutex.unlock();
+
+  // removedEntry releases the task out of the lock
+}
+
+bool TimingWheel::isScheduled(std::shared_ptr<Task> pTask)
+{
+  bool result;
+
+  mMutex.lock();
+    result = mEntries.contains( pTask.get() );
+  mMutex.unlock();
+
+  return result;
+}
+
+std::chrono::microseconds TimingWheel::getTick(void)
+{
+  return mTick;
+}
+
+void TimingWheel::execute(void)
+{
+  if( !mThread ){
+    mThread = std::make_shared<std::thread>( &TimingWheel::_execute, shared_from_this() );
+  }
+}
+
+void TimingWheel::terminate(void)
+{
+  if( mThread ){
+    mMutex.lock();
+      mStopping = true;
+    mMutex.unlock();
+    mCondition.notify_all();
+
+    if( mThread->joinable() ){
+      if( mThread->get_id() == std::this_thread::get_id() ){
+        // terminated by the dispatched task's release on the wheel's thread : the thread exits after dispatch() and _execute() keeps this alive until then
+        mThread->detach();
+      } else {
+        mThread->join();
+        mStopping = false;
+      }
+    }
+    mThread.reset();
+  }
+}
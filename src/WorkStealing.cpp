@@ -0,0 +1,227 @@
+/*
+  Copyright (C) 2022 hidenorly
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "WorkStealing.hpp"
+
+WorkStealingDeque::WorkStealingDeque(size_t nCapacity) : mTop( 0 ), mBottom( 0 )
+{
+  size_t nSize = 2;
+  while( nSize < nCapacity ){
+    nSize = nSize << 1;
+  }
+  mBuffer = std::vector<Slot>( nSize );
+  mMask = nSize - 1;
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+  while( pop() );
+}
+
+std::shared_ptr<ITask> WorkStealingDeque::take(int64_t nIndex)
+{
+  Slot& slot = mBuffer[ nIndex & mMask ];
+  std::shared_ptr<ITask> result = std::move( slot.pTask );
+  slot.bIsBusy.store( false, std::memory_order_release );
+
+  return result;
+}
+
+bool WorkStealingDeque::push(std::shared_ptr<ITask> pTask)
+{
+  int64_t b = mBottom.load( std::memory_order_relaxed );
+  int64_t t = mTop.load( std::memory_order_acquire );
+  Slot& slot = mBuffer[ b & mMask ];
+
+  // the thief which won the previous index of this slot may not have moved it out yet
+  if( b - t > mMask || slot.bIsBusy.load( std::memory_order_acquire ) ){
+    return false;
+  }
+  slot.pTask = std::move( pTask );
+  slot.bIsBusy.store( true, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  mBottom.store( b + 1, std::memory_order_relaxed );
+
+  return true;
+}
+
+std::shared_ptr<ITask> WorkStealingDeque::pop(void)
+{
+  bool bTaken = false;
+
+  int64_t b = mBottom.load( std::memory_order_relaxed ) - 1;
+  mBottom.store( b, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  int64_t t = mTop.load( std::memory_order_relaxed );
+
+  if( t <= b ){
+    bTaken = true;
+    if( t == b ){
+      // the last one : race with the thieves
+      bTaken = mTop.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+      mBottom.store( b + 1, std::memory_order_relaxed );
+    }
+  } else {
+    mBottom.store( b + 1, std::memory_order_relaxed );
+  }
+
+  return bTaken ? take( b ) : nullptr;
+}
+
+std::shared_ptr<ITask> WorkStealingDeque::steal(void)
+{
+  bool bTaken = false;
+
+  int64_t t = mTop.load( std::memory_order_acquire );
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  int64_t b = mBottom.load( std::memory_order_acquire );
+
+  // the slot is read only after winning the index, then the loser never touches the slot being reused
+  if( t < b ){
+    bTaken = mTop.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+  }
+
+  return bTaken ? take( t ) : nullptr;
+}
+
+bool WorkStealingDeque::isEmpty(void)
+{
+  return mBottom.load( std::memory_order_relaxed ) <= mTop.load( std::memory_order_relaxed );
+}
+
+
+WorkStealingGroup::WorkStealingGroup(int nNumOfThreads) : mHasCancelled( false )
+{
+  for( int i = 0; i < nNumOfThreads; i++ ){
+    mDeques.push_back( std::make_shared<WorkStealingDeque>() );
+  }
+}
+
+WorkStealingGroup::~WorkStealingGroup()
+{
+  clear();
+}
+
+void WorkStealingGroup::clear(void)
+{
+  // steal() is safe against the owner still finishing its last task
+  for( auto& pDeque : mDeques ){
+    std::shared_ptr<ITask> pTask;
+    while( ( pTask = pDeque->steal() ) ){
+      if( !isCancelled( pTask ) ){
+        pTask->onAbandon();
+      }
+    }
+  }
+}
+
+std::shared_ptr<WorkStealingDeque> WorkStealingGroup::getDeque(int nIndex)
+{
+  std::shared_ptr<WorkStealingDeque> result;
+
+  if( nIndex >= 0 && nIndex < (int)mDeques.size() ){
+    result = mDeques[ nIndex ];
+  }
+
+  return result;
+}
+
+std::shared_ptr<ITask> WorkStealingGroup::steal(int nThief, uint32_t& nRandom)
+{
+  std::shared_ptr<ITask> result;
+  int nSize = mDeques.size();
+
+  // xorshift32
+  nRandom ^= nRandom << 13;
+  nRandom ^= nRandom >> 17;
+  nRandom ^= nRandom << 5;
+
+  for( int i = 0, nVictim = nRandom % nSize; i < nSize && !result; i++, nVictim = ( nVictim + 1 ) % nSize ){
+    if( nVictim != nThief ){
+      result = mDeques[ nVictim ]->steal();
+    }
+  }
+
+  return result;
+}
+
+bool WorkStealingGroup::cancel(std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  // the task only in the shared TaskPool or running doesn't need the mark
+  if( pTask && pTask->getNumOfLocalEntries() > 0 ){
+    mMutexCancelled.lock();
+      mCancelledTasks.insert( pTask.get() );
+      mHasCancelled = true;
+    mMutexCancelled.unlock();
+    result = true;
+    // the last entry may be taken before the mark. if the mark is still there, nobody skipped the task by it
+    if( !pTask->getNumOfLocalEntries() ){
+      mMutexCancelled.lock();
+        result = !mCancelledTasks.erase( pTask.get() );
+        mHasCancelled = !mCancelledTasks.empty();
+      mMutexCancelled.unlock();
+    }
+  }
+
+  return result;
+}
+
+bool WorkStealingGroup::push(std::shared_ptr<WorkStealingDeque> pDeque, std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  if( pDeque && pTask ){
+    // count it before the push, the thief may take it immediately
+    pTask->addLocalEntries( 1 );
+    result = pDeque->push( pTask );
+    if( !result ){
+      pTask->addLocalEntries( -1 );
+    }
+  }
+
+  return result;
+}
+
+void WorkStealingGroup::resume(std::shared_ptr<ITask> pTask)
+{
+  if( mHasCancelled ){
+    mMutexCancelled.lock();
+      mCancelledTasks.erase( pTask.get() );
+      mHasCancelled = !mCancelledTasks.empty();
+    mMutexCancelled.unlock();
+  }
+}
+
+bool WorkStealingGroup::isCancelled(std::shared_ptr<ITask> pTask)
+{
+  bool result = false;
+
+  bool bLastEntry = ( pTask->addLocalEntries( -1 ) == 0 );
+  if( mHasCancelled ){
+    mMutexCancelled.lock();
+      auto it = mCancelledTasks.find( pTask.get() );
+      result = ( it != mCancelledTasks.end() );
+      if( result && bLastEntry ){
+        mCancelledTasks.erase( it );
+        mHasCancelled = !mCancelledTasks.empty();
+      }
+    mMutexCancelled.unlock();
+  }
+
+  return result;
+}
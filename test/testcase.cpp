@@ -21,8 +21,23 @@
 #include "ThreadPool.hpp"
 #include "LambdaTask.hpp"
 #include "Timer.hpp"
+#include "LockFreeTaskPool.hpp"
+#include "PriorityTaskPool.hpp"
+#include "DeadlineTaskPool.hpp"
+#include "TimingWheel.hpp"
+#include "WorkStealing.hpp"
+#include "ParallelAlgorithm.hpp"
+#include "TaskGraph.hpp"
 #include <iostream>
+#include <set>
+#include <numeric>
+#include <array>
 #include <chrono>
+#include <ctime>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 TestCase_TaskManager::TestCase_TaskManager()
 {
@@ -88,6 +103,101 @@ TEST_F(TestCase_TaskManager, testTaskManager)
   pTaskMan->finalize();
 }
 
+TEST_F(TestCase_TaskManager, testTaskManagerReuseThreads)
+{
+  const int nNumOfTasks = 1000;
+  const int nMaxThread = 4;
+  std::atomic<int> counter = 0;
+  std::mutex mutex;
+  std::set<std::thread::id> threadIds;
+
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( nMaxThread );
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    pTaskMan->addTask( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){
+      counter++;
+      mutex.lock();
+        threadIds.insert( std::this_thread::get_id() );
+      mutex.unlock();
+    } ) );
+  }
+
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  pTaskMan->executeAllTasks();
+  while( counter < nNumOfTasks && std::chrono::steady_clock::now() - startTime < std::chrono::seconds(5) ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::cout << std::to_string( nNumOfTasks ) << " tasks executed in " << std::to_string( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - startTime ).count() ) << "usec" << std::endl;
+
+  // the workers are reused instead of the thread per task
+  EXPECT_EQ( counter, nNumOfTasks );
+  EXPECT_LE( threadIds.size(), nMaxThread );
+  EXPECT_FALSE( pTaskMan->isRemainingTasks() );
+
+  // the stopped TaskManager doesn't start the remaining tasks
+  std::atomic<int> stoppedCounter = 0;
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    pTaskMan->addTask( std::make_shared<LambdaTask>( [&stoppedCounter](std::shared_ptr<Task> pTask){
+      stoppedCounter++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } ) );
+  }
+  pTaskMan->executeAllTasks();
+  pTaskMan->stopAllTasks();
+  int nStoppedCount = stoppedCounter;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE( pTaskMan->isRunning() );
+  EXPECT_EQ( stoppedCounter, nStoppedCount );
+  EXPECT_LE( nStoppedCount, nMaxThread );
+
+  pTaskMan->finalize();
+}
+
+class SpinTask : public Task
+{
+public:
+  virtual void onExecute(void)
+  {
+    while( !mStopRunning ){
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+};
+
+TEST_F(TestCase_TaskManager, testTaskCompletion)
+{
+  const int nNumOfTasks = 50;
+  std::vector<std::shared_ptr<Task>> tasks;
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( nNumOfTasks );
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    tasks.push_back( std::make_shared<SpinTask>() );
+    pTaskMan->addTask( tasks.back() );
+  }
+  pTaskMan->executeAllTasks();
+  for( auto& pTask : tasks ){
+    while( !pTask->isRunning() ){
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  // the running task doesn't complete until it's cancelled
+  EXPECT_FALSE( tasks[0]->waitForCompletion( std::chrono::milliseconds( 10 ) ) );
+  EXPECT_FALSE( Task::waitForCompletion( tasks, std::chrono::milliseconds( 10 ) ) );
+  pTaskMan->cancelTask( tasks[0] );
+  EXPECT_FALSE( tasks[0]->isRunning() );
+  EXPECT_TRUE( tasks[0]->waitForCompletion( std::chrono::milliseconds( 10 ) ) );
+
+  // the cancellation returns as soon as the tasks exit instead of polling each of them
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  pTaskMan->stopAllTasks();
+  int64_t nDuration = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - startTime ).count();
+  std::cout << "stopAllTasks() for " << std::to_string( nNumOfTasks - 1 ) << " running tasks took " << std::to_string( nDuration ) << "usec" << std::endl;
+
+  EXPECT_TRUE( Task::waitForCompletion( tasks, std::chrono::nanoseconds( 0 ) ) );
+  EXPECT_FALSE( pTaskMan->isRunning() );
+  EXPECT_LT( nDuration, 40000 );
+  pTaskMan->finalize();
+}
+
 TEST_F(TestCase_TaskManager, testPeridocTask)
 {
   std::shared_ptr<PeriodicTask> pPeriodicTask = std::make_shared<PeriodicTask>(1000);
@@ -111,6 +221,192 @@ TEST_F(TestCase_TaskManager, testPeridocTask)
 }
 #endif
 
+// execute the PeriodicTask whose first tick takes 70msec at 20msec period for 300msec and return the run times relative to the first run
+static std::vector<int64_t> executeOverrunPeriodicTask(PeriodicTask::OverrunPolicy overrunPolicy)
+{
+  std::vector<int64_t> runTimes;
+  std::chrono::steady_clock::time_point firstTime;
+  std::shared_ptr<PeriodicTask> pPeriodicTask = std::make_shared<PeriodicTask>( 20, overrunPolicy );
+  pPeriodicTask->addTask( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if( runTimes.empty() ){
+      firstTime = now;
+    }
+    runTimes.push_back( std::chrono::duration_cast<std::chrono::milliseconds>( now - firstTime ).count() );
+    if( runTimes.size() == 1 ){
+      std::this_thread::sleep_for(std::chrono::milliseconds(70));
+    }
+  } ) );
+
+  std::thread executor( [pPeriodicTask](){ pPeriodicTask->execute(); } );
+  std::this_thread::sleep_for(std::chrono::milliseconds(310));
+  pPeriodicTask->cancel();
+  executor.join();
+
+  return runTimes;
+}
+
+TEST_F(TestCase_TaskManager, testPeriodicTaskOverrunPolicy)
+{
+  // skip : the missed ticks (20, 40, 60msec) are skipped and the phase is kept
+  std::vector<int64_t> runTimes = executeOverrunPeriodicTask( PeriodicTask::OverrunPolicy::SKIP );
+  ASSERT_GE( runTimes.size(), 2 );
+  EXPECT_GE( runTimes[1], 75 );
+  for( auto& nRunTime : runTimes ){
+    EXPECT_LT( std::min( nRunTime % 20, 20 - nRunTime % 20 ), 5 );
+  }
+
+  // catch up : the missed ticks are executed back to back
+  runTimes = executeOverrunPeriodicTask( PeriodicTask::OverrunPolicy::CATCH_UP );
+  ASSERT_GE( runTimes.size(), 4 );
+  EXPECT_GE( runTimes[1], 70 );
+  EXPECT_LT( runTimes[3] - runTimes[1], 10 );
+  EXPECT_GE( runTimes.size(), 13 );
+
+  // coalesce : the missed ticks are executed once and the period restarts from there
+  runTimes = executeOverrunPeriodicTask( PeriodicTask::OverrunPolicy::COALESCE );
+  ASSERT_GE( runTimes.size(), 3 );
+  EXPECT_GE( runTimes[1], 70 );
+  EXPECT_LT( runTimes[1], 80 );
+  EXPECT_GE( runTimes[2] - runTimes[1], 20 );
+}
+
+class OverrunListener : public PeriodicTask::IOverrunListener
+{
+public:
+  std::atomic<int> mNumOfOverruns = 0;
+  std::atomic<uint64_t> mNumOfSkippedTicks = 0;
+  std::atomic<int64_t> mMaxLatenessMsec = 0;
+
+  virtual void onOverrun(std::chrono::nanoseconds period, std::chrono::nanoseconds lateness, uint64_t nSkippedTicks)
+  {
+    mNumOfOverruns++;
+    mNumOfSkippedTicks += nSkippedTicks;
+    mMaxLatenessMsec = std::max<int64_t>( mMaxLatenessMsec, std::chrono::duration_cast<std::chrono::milliseconds>( lateness ).count() );
+  }
+};
+
+TEST_F(TestCase_TaskManager, testPeriodicTaskStatistics)
+{
+  // the first run takes 70msec at 20msec period, then the ticks at 40, 60 and 80msec are skipped
+  std::atomic<int> counter = 0;
+  std::shared_ptr<OverrunListener> pListener = std::make_shared<OverrunListener>();
+  std::shared_ptr<PeriodicTaskManager> pTaskMan = std::make_shared<PeriodicTaskManager>( PeriodicTask::OverrunPolicy::SKIP );
+  pTaskMan->setOverrunListener( pListener );
+  std::shared_ptr<Task> pTask = std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){
+    if( !counter++ ){
+      std::this_thread::sleep_for(std::chrono::milliseconds(70));
+    }
+  } );
+  pTaskMan->scheduleRepeat( pTask, 20 );
+
+  pTaskMan->execute();
+  std::this_thread::sleep_for(std::chrono::milliseconds(310));
+
+  // the snapshots after terminate() aren't torn by the running tick
+  pTaskMan->terminate();
+  std::map<std::chrono::nanoseconds, PeriodicTask::Statistics> statistics = pTaskMan->getStatistics();
+  PeriodicTask::TaskStatistics taskStatistics = pTaskMan->getTaskStatistics( pTask );
+
+  ASSERT_TRUE( statistics.contains( std::chrono::milliseconds( 20 ) ) );
+  PeriodicTask::Statistics& periodStatistics = statistics[ std::chrono::milliseconds( 20 ) ];
+  std::cout << "ticks:" << periodStatistics.nTicks << " overruns:" << periodStatistics.nOverruns << " skipped:" << periodStatistics.nSkippedTicks << " jitter p99:" << periodStatistics.startJitter.getPercentile( 99 ).count() << "ns" << std::endl;
+  EXPECT_GE( periodStatistics.nTicks, 10 );
+  EXPECT_GE( periodStatistics.nOverruns, 1 );
+  EXPECT_GE( periodStatistics.nSkippedTicks, 3 );
+  EXPECT_EQ( periodStatistics.startJitter.nCount, periodStatistics.nTicks );
+  EXPECT_GE( periodStatistics.executionTime.getMax(), std::chrono::milliseconds( 70 ) );
+
+  EXPECT_EQ( taskStatistics.nExecutions, periodStatistics.nTicks );
+  EXPECT_EQ( taskStatistics.nOverruns, 1 );
+  EXPECT_GE( taskStatistics.executionTime.getMax(), std::chrono::milliseconds( 70 ) );
+
+  EXPECT_EQ( pListener->mNumOfOverruns, periodStatistics.nOverruns );
+  EXPECT_EQ( pListener->mNumOfSkippedTicks, periodStatistics.nSkippedTicks );
+  EXPECT_GE( pListener->mMaxLatenessMsec, 40 );
+}
+
+TEST_F(TestCase_TaskManager, testPeriodicTaskDrift)
+{
+  const std::chrono::milliseconds period( 10 );
+  std::mutex mutex;
+  std::vector<std::chrono::steady_clock::time_point> ticks;
+  std::shared_ptr<PeriodicTask> pPeriodicTask = std::make_shared<PeriodicTask>( period.count() );
+  pPeriodicTask->addTask( std::make_shared<LambdaTask>( [&mutex, &ticks](std::shared_ptr<Task> pTask){
+    std::lock_guard<std::mutex> lock( mutex );
+    ticks.push_back( std::chrono::steady_clock::now() );
+  } ) );
+
+  std::thread executor( [pPeriodicTask](){ pPeriodicTask->execute(); } );
+  std::this_thread::sleep_for(std::chrono::milliseconds(1005));
+  pPeriodicTask->cancel();
+  executor.join();
+
+  std::lock_guard<std::mutex> lock( mutex );
+  std::cout << "10msec period executed " << std::to_string( ticks.size() ) << " times in 1005msec" << std::endl;
+  EXPECT_GE( ticks.size(), 95 );
+  EXPECT_LE( ticks.size(), 101 );
+  ASSERT_GE( ticks.size(), 20 );
+
+  // the absolute deadline doesn't accumulate the sleep error : the k-th tick stays at the first tick + k * period.
+  // the minimum over the last ticks ignores the single late tick by the scheduler
+  std::chrono::nanoseconds minDrift = std::chrono::nanoseconds::max();
+  for( size_t k = ticks.size() - 10; k < ticks.size(); k++ ){
+    std::chrono::nanoseconds drift = ticks[k] - ( ticks[0] + period * k );
+    minDrift = std::min( minDrift, drift );
+  }
+  std::cout << "drift at the last ticks:" << std::to_string( minDrift.count() / 1000 ) << " usec" << std::endl;
+  EXPECT_LT( minDrift, std::chrono::milliseconds( 2 ) );
+}
+
+TEST_F(TestCase_TaskManager, testParallelPeriodicTask)
+{
+  // 3 tasks taking 30msec at 50msec period : they overrun if they run one after another
+  const int nNumOfTasks = 3;
+  std::vector<std::atomic<int>> counters( nNumOfTasks );
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( nNumOfTasks );
+  std::shared_ptr<PeriodicTaskManager> pTaskMan = std::make_shared<PeriodicTaskManager>( PeriodicTask::OverrunPolicy::SKIP, std::chrono::nanoseconds( 0 ), pThreadPool );
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    pTaskMan->scheduleRepeat( std::make_shared<LambdaTask>( [&counters, i](std::shared_ptr<Task> pTask){
+      counters[i]++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    } ), 50 );
+  }
+
+  pTaskMan->execute();
+  std::this_thread::sleep_for(std::chrono::milliseconds(520));
+  pTaskMan->terminate();
+  pThreadPool->terminate();
+
+  for( auto& counter : counters ){
+    std::cout << "50msec period with 30msec tasks executed " << std::to_string( counter ) << " times in 520msec" << std::endl;
+    EXPECT_GE( counter, 9 );
+  }
+}
+
+TEST_F(TestCase_TaskManager, testHighResolutionPeriodicTask)
+{
+  std::atomic<int> counter = 0;
+  std::chrono::nanoseconds maxLateness( 0 );
+  std::chrono::steady_clock::time_point lastTime;
+  std::shared_ptr<PeriodicTaskManager> pTaskMan = std::make_shared<PeriodicTaskManager>( PeriodicTask::OverrunPolicy::COALESCE, std::chrono::microseconds( 50 ) );
+  pTaskMan->scheduleRepeat( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if( counter++ ){
+      maxLateness = std::max( maxLateness, std::chrono::duration_cast<std::chrono::nanoseconds>( now - lastTime ) - std::chrono::microseconds( 250 ) );
+    }
+    lastTime = now;
+  } ), std::chrono::microseconds( 250 ) );
+
+  pTaskMan->execute();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  pTaskMan->terminate();
+
+  std::cout << "250usec period executed " << std::to_string( counter ) << " times in 200msec (max lateness " << std::to_string( maxLateness.count() / 1000 ) << " usec)" << std::endl;
+  EXPECT_GE( counter, 600 );
+  EXPECT_LE( counter, 801 );
+}
+
 
 TEST_F(TestCase_TaskManager, testThreadPool)
 {
@@ -142,6 +438,1068 @@ TEST_F(TestCase_TaskManager, testThreadPool)
   pThreadPool->terminate();
 }
 
+TEST_F(TestCase_TaskManager, testFuture)
+{
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  pThreadPool->execute();
+
+  // the result and the arguments
+  Future<int> sum = pThreadPool->submit( [](int a, int b){ return a + b; }, 1, 2 );
+  EXPECT_EQ( sum.get(), 3 );
+
+  // the continuation is chained without blocking a thread per stage
+  Future<std::string> pipeline = pThreadPool->submit( [](){ std::this_thread::sleep_for(std::chrono::milliseconds(50)); return 21; } )
+    .then( [](int x){ return x * 2; } )
+    .then( [](int x){ return std::to_string( x ); } );
+  EXPECT_EQ( pipeline.wait_for( std::chrono::milliseconds( 1 ) ), std::future_status::timeout );
+  EXPECT_EQ( pipeline.get(), "42" );
+  EXPECT_TRUE( pipeline.isReady() );
+
+  // then() of the completed Future runs immediately
+  Future<int> completed = pThreadPool->submit( [](int a, int b){ return a + b; }, 1, 2 );
+  completed.wait();
+  EXPECT_EQ( completed.then( [](int x){ return x + 1; } ).get(), 4 );
+
+  // the move-only result is moved out by get() and by the continuation
+  Future<std::unique_ptr<int>> owned = pThreadPool->submit( [](){ return std::make_unique<int>( 5 ); } );
+  std::unique_ptr<int> pOwned = owned.get();
+  ASSERT_TRUE( pOwned );
+  EXPECT_EQ( *pOwned, 5 );
+  Future<int> chained = pThreadPool->submit( [](){ return std::make_unique<int>( 6 ); } ).then( [](std::unique_ptr<int> pValue){ return *pValue + 1; } );
+  EXPECT_EQ( chained.get(), 7 );
+
+  // void and the exception propagation through the chain
+  std::atomic<int> counter = 0;
+  Future<void> done = pThreadPool->submit( [&counter](){ counter++; } ).then( [&counter](){ counter++; } );
+  done.wait();
+  EXPECT_EQ( counter, 2 );
+
+  Future<int> failed = pThreadPool->submit( []() -> int { throw std::runtime_error( "failed" ); } ).then( [&counter](int x){ counter++; return x; } );
+  EXPECT_THROW( failed.get(), std::runtime_error );
+  EXPECT_EQ( counter, 2 );
+
+  // many futures
+  std::vector<Future<int>> futures;
+  for( int i = 0; i < 1000; i++ ){
+    futures.push_back( pThreadPool->submit( [](int x){ return x * x; }, i ) );
+  }
+  int64_t nTotal = 0;
+  for( auto& aFuture : futures ){
+    nTotal += aFuture.get();
+  }
+  EXPECT_EQ( nTotal, 332833500 );
+
+  pThreadPool->terminate();
+
+  // the queued task cancelled breaks the promise instead of the infinite wait. the running one and the one never queued are kept
+  std::shared_ptr<ThreadPool> pSingleThreadPool = std::make_shared<ThreadPool>( 1 );
+  pSingleThreadPool->execute();
+  std::atomic<bool> bStarted = false;
+  std::atomic<bool> bReleased = false;
+  auto blocker = [&bStarted, &bReleased](){
+    bStarted = true;
+    while( !bReleased ){
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return 2;
+  };
+  auto func = [](){ return 1; };
+  std::shared_ptr<PackagedTask<int, decltype(blocker)>> pRunningTask = ThreadPool::makeTask<PackagedTask<int, decltype(blocker)>>( std::move( blocker ) );
+  std::shared_ptr<PackagedTask<int, decltype(func)>> pCancelledTask = ThreadPool::makeTask<PackagedTask<int, decltype(func)>>( decltype(func)( func ) );
+  std::shared_ptr<PackagedTask<int, decltype(func)>> pNotQueuedTask = ThreadPool::makeTask<PackagedTask<int, decltype(func)>>( std::move( func ) );
+  Future<int> running( pRunningTask );
+  Future<int> cancelled( pCancelledTask );
+  Future<int> notQueued( pNotQueuedTask );
+  pSingleThreadPool->addTask( pRunningTask );
+  pSingleThreadPool->addTask( pCancelledTask );
+  for( int i = 0; i < 1000 && !bStarted; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  pSingleThreadPool->canceTask( pRunningTask );
+  pSingleThreadPool->canceTask( pCancelledTask );
+  pSingleThreadPool->canceTask( pNotQueuedTask );
+  EXPECT_EQ( cancelled.wait_for( std::chrono::seconds( 5 ) ), std::future_status::ready );
+  EXPECT_THROW( cancelled.get(), std::future_error );
+  EXPECT_EQ( notQueued.wait_for( std::chrono::milliseconds( 10 ) ), std::future_status::timeout );
+  bReleased = true;
+  EXPECT_EQ( running.get(), 2 );
+  pSingleThreadPool->addTask( pNotQueuedTask );
+  EXPECT_EQ( notQueued.get(), 1 );
+  pSingleThreadPool->terminate();
+
+  // so does the task dropped by terminate() before it runs, and it's propagated to the continuation
+  std::shared_ptr<ThreadPool> pIdleThreadPool = std::make_shared<ThreadPool>( 1 );
+  Future<int> dropped = pIdleThreadPool->submit( [](){ return 1; } ).then( [](int x){ return x + 1; } );
+  pIdleThreadPool->terminate();
+  EXPECT_EQ( dropped.wait_for( std::chrono::seconds( 5 ) ), std::future_status::ready );
+  try {
+    dropped.get();
+    ADD_FAILURE();
+  } catch (const std::future_error& e) {
+    EXPECT_EQ( e.code(), std::future_errc::broken_promise );
+  }
+}
+
+#if ASYNC_TASK_COROUTINE
+static CoTask<std::thread::id> getWorkerThreadId(ThreadPool* pThreadPool)
+{
+  co_await pThreadPool->schedule();
+  co_return std::this_thread::get_id();
+}
+
+static CoTask<int> sleepAndAdd(ThreadPool* pThreadPool, std::chrono::milliseconds delay, int nValue)
+{
+  co_await Timer::after( delay );
+  int nResult = co_await pThreadPool->submit( [](int a, int b){ return a + b; }, nValue, 1 );
+  co_return nResult;
+}
+
+static CoTask<> countAfterDelay(ThreadPool* pThreadPool, std::atomic<int>* pCounter)
+{
+  co_await pThreadPool->schedule();
+  co_await Timer::after( std::chrono::milliseconds( 50 ) );
+  (*pCounter)++;
+}
+
+static CoTask<> throwAfterSchedule(ThreadPool* pThreadPool)
+{
+  co_await pThreadPool->schedule();
+  throw std::runtime_error( "coroutine error" );
+}
+#endif /* ASYNC_TASK_COROUTINE */
+
+TEST_F(TestCase_TaskManager, testCoroutine)
+{
+#if ASYNC_TASK_COROUTINE
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  pThreadPool->execute();
+
+  // schedule() hops onto the worker
+  EXPECT_NE( getWorkerThreadId( pThreadPool.get() ).get(), std::this_thread::get_id() );
+
+  // Timer::after() and the awaited Future
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  EXPECT_EQ( sleepAndAdd( pThreadPool.get(), std::chrono::milliseconds( 20 ), 41 ).get(), 42 );
+  EXPECT_GE( std::chrono::steady_clock::now() - startTime, std::chrono::milliseconds( 20 ) );
+
+  EXPECT_THROW( throwAfterSchedule( pThreadPool.get() ).get(), std::runtime_error );
+
+  // 1000 flows waiting 50msec concurrently on 2 workers without blocking them
+  const int nNumOfFlows = 1000;
+  std::atomic<int> counter = 0;
+  std::vector<CoTask<>> flows;
+  startTime = std::chrono::steady_clock::now();
+  for( int i = 0; i < nNumOfFlows; i++ ){
+    flows.push_back( countAfterDelay( pThreadPool.get(), &counter ) );
+    flows.back().start();
+  }
+  for( auto& flow : flows ){
+    flow.wait();
+  }
+  std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+  std::cout << nNumOfFlows << " coroutines waiting 50msec completed in " << duration.count() << "msec" << std::endl;
+  EXPECT_EQ( counter, nNumOfFlows );
+  EXPECT_LT( duration, std::chrono::milliseconds( 1000 ) );
+
+  pThreadPool->terminate();
+#else
+  GTEST_SKIP() << "the coroutine isn't supported by the compiler";
+#endif /* ASYNC_TASK_COROUTINE */
+}
+
+TEST_F(TestCase_TaskManager, testInplaceTask)
+{
+  std::shared_ptr<int> pValue = std::make_shared<int>( 0 );
+
+  // the small callable is kept inline and the big one falls back to the heap
+  InplaceTask smallTask( [pValue](){ (*pValue)++; } );
+  std::array<char, 128> bigCapture = { 1 };
+  InplaceTask bigTask( [pValue, bigCapture](){ (*pValue) += bigCapture[0]; } );
+  EXPECT_EQ( pValue.use_count(), 3 );
+
+  // move-only
+  InplaceTask movedTask( std::move( smallTask ) );
+  EXPECT_FALSE( smallTask );
+  EXPECT_TRUE( movedTask );
+  movedTask();
+  bigTask();
+  EXPECT_EQ( *pValue, 2 );
+  movedTask = std::move( bigTask );
+  EXPECT_EQ( pValue.use_count(), 2 );
+  movedTask.reset();
+  EXPECT_EQ( pValue.use_count(), 1 );
+
+  // queued by value
+  const int nNumOfTasks = 100000;
+  std::atomic<int> counter = 0;
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    pThreadPool->addTask( [&counter](){ counter++; } );
+  }
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  pThreadPool->execute();
+  while( counter < nNumOfTasks && std::chrono::steady_clock::now() - startTime < std::chrono::seconds(5) ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::cout << std::to_string( nNumOfTasks ) << " InplaceTasks executed in " << std::to_string( std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count() ) << "msec" << std::endl;
+  EXPECT_EQ( counter, nNumOfTasks );
+  pThreadPool->terminate();
+
+  // the shared_ptr task isn't starved by the sustained InplaceTask load
+  std::shared_ptr<ThreadPool> pSingleThreadPool = std::make_shared<ThreadPool>( 1 );
+  std::atomic<bool> bStop = false;
+  std::atomic<int> nNumOfInplaceRuns = 0;
+  std::function<void(void)> reschedule = [&](){
+    nNumOfInplaceRuns++;
+    if( !bStop ){
+      pSingleThreadPool->addTask( InplaceTask( [&reschedule](){ reschedule(); } ) );
+    }
+  };
+  for( int i = 0; i < 4; i++ ){
+    pSingleThreadPool->addTask( InplaceTask( [&reschedule](){ reschedule(); } ) );
+  }
+  Future<int> future = pSingleThreadPool->submit( [](){ return 1; } );
+  pSingleThreadPool->execute();
+  EXPECT_EQ( future.wait_for( std::chrono::seconds( 5 ) ), std::future_status::ready );
+  bStop = true;
+  pSingleThreadPool->terminate();
+}
+
+TEST_F(TestCase_TaskManager, testObjectPool)
+{
+  ObjectPool::resetStatistics();
+
+  // the released block is recycled by the same thread
+  std::weak_ptr<LambdaTask> pWeakTask;
+  {
+    std::shared_ptr<LambdaTask> pTask = ThreadPool::makeTask<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+    pWeakTask = pTask;
+    EXPECT_EQ( pTask->shared_from_this(), pTask );
+  }
+  EXPECT_TRUE( pWeakTask.expired() );
+  pWeakTask.reset();
+  std::shared_ptr<LambdaTask> pTask = ThreadPool::makeTask<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  pTask.reset();
+  EXPECT_GE( ObjectPool::getStatistics().nHits, 1 );
+
+  // the tasks made by this thread and released by the worker come back via the depot
+  const int nNumOfRounds = 20;
+  const int nNumOfTasks = 1000;
+  std::atomic<int> counter = 0;
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 1 );
+  pThreadPool->execute();
+  ObjectPool::resetStatistics();
+  for( int i = 0; i < nNumOfRounds; i++ ){
+    for( int j = 0; j < nNumOfTasks; j++ ){
+      pThreadPool->addTask( ThreadPool::makeTask<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter++; } ) );
+    }
+    while( counter < ( i + 1 ) * nNumOfTasks ){
+      std::this_thread::yield();
+    }
+  }
+  pThreadPool->terminate();
+
+  ObjectPool::Statistics statistics = ObjectPool::getStatistics();
+  std::cout << "ObjectPool hit rate:" << std::to_string( statistics.getHitRate() ) << " (hits:" << std::to_string( statistics.nHits ) << " misses:" << std::to_string( statistics.nMisses ) << ")" << std::endl;
+  EXPECT_GT( statistics.getHitRate(), 0.8 );
+
+  // the depot's surplus is returned to the system allocator
+  size_t nMaxDepotBatches = ObjectPool::getMaxDepotBatches();
+  EXPECT_EQ( nMaxDepotBatches, (size_t)ObjectPool::DEFAULT_MAX_DEPOT_BATCHES );
+  ObjectPool::setMaxDepotBatches( 0 );
+  EXPECT_GT( ObjectPool::getStatistics().nReleased, statistics.nReleased );
+  ObjectPool::setMaxDepotBatches( nMaxDepotBatches );
+}
+
+TEST_F(TestCase_TaskManager, testThreadPoolMetrics)
+{
+  LatencyHistogram histogram;
+  for( int i = 1; i <= 1000; i++ ){
+    histogram.record( std::chrono::microseconds( i ) );
+  }
+  LatencyHistogram::Snapshot snapshot = histogram.getSnapshot();
+  EXPECT_EQ( snapshot.nCount, 1000 );
+  EXPECT_EQ( snapshot.getMax(), std::chrono::microseconds( 1000 ) );
+  EXPECT_GE( snapshot.getPercentile( 50 ), std::chrono::microseconds( 500 ) );
+  EXPECT_LE( snapshot.getPercentile( 50 ), std::chrono::microseconds( 1000 ) );
+  EXPECT_EQ( snapshot.getPercentile( 100 ), std::chrono::microseconds( 1000 ) );
+
+  // the tasks queued before execute() make the high-water mark
+  const int nNumOfTasks = 100;
+  std::atomic<int> counter = 0;
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  pThreadPool->enableMetrics();
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    pThreadPool->addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      counter++;
+    } ) );
+  }
+  pThreadPool->addTask( [&counter](){ counter++; } );
+  EXPECT_EQ( pThreadPool->getMetrics().nQueueDepth, nNumOfTasks + 1 );
+  pThreadPool->execute();
+  // the worker records the task after it returns, then wait for the record instead of the counter
+  ThreadPool::Metrics metrics = pThreadPool->getMetrics();
+  std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+  while( metrics.nExecutedTasks < nNumOfTasks + 1 && std::chrono::steady_clock::now() < timeout ){
+    std::this_thread::yield();
+    metrics = pThreadPool->getMetrics();
+  }
+  EXPECT_EQ( counter, nNumOfTasks + 1 );
+  std::cout << "executed:" << metrics.nExecutedTasks << " utilization:" << metrics.getUtilization() << " wait p99:" << metrics.waitLatency.getPercentile( 99 ).count() << "ns exec p99:" << metrics.executionLatency.getPercentile( 99 ).count() << "ns" << std::endl;
+  EXPECT_EQ( metrics.nNumOfThreads, 2 );
+  EXPECT_EQ( metrics.nExecutedTasks, nNumOfTasks + 1 );
+  EXPECT_EQ( metrics.executedTasksPerWorker.size(), 2 );
+  EXPECT_EQ( metrics.nQueueDepth, 0 );
+  EXPECT_EQ( metrics.nMaxQueueDepth, nNumOfTasks + 1 );
+  // InplaceTask has no enqueue time
+  EXPECT_EQ( metrics.waitLatency.nCount, nNumOfTasks );
+  EXPECT_EQ( metrics.executionLatency.nCount, nNumOfTasks + 1 );
+  EXPECT_GE( metrics.executionLatency.getMax(), std::chrono::microseconds( 100 ) );
+  EXPECT_GE( metrics.busyTime, std::chrono::microseconds( 100 * nNumOfTasks ) );
+  EXPECT_GT( metrics.getUtilization(), 0.0 );
+
+  pThreadPool->resetMetrics();
+  metrics = pThreadPool->getMetrics();
+  EXPECT_EQ( metrics.nExecutedTasks, 0 );
+  EXPECT_EQ( metrics.nMaxQueueDepth, 0 );
+  EXPECT_EQ( metrics.waitLatency.nCount, 0 );
+
+  pThreadPool->terminate();
+}
+
+TEST_F(TestCase_TaskManager, testThreadPoolIdle)
+{
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 4 );
+  pThreadPool->execute();
+
+  // the idle workers should be parked instead of spinning
+  std::clock_t startCpuTime = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  double idleCpuMsec = 1000.0 * ( std::clock() - startCpuTime ) / CLOCKS_PER_SEC;
+  std::cout << "idle cpu time:" << std::to_string( idleCpuMsec ) << "msec" << std::endl;
+  EXPECT_LT( idleCpuMsec, 100.0 );
+
+  // and should wake up as soon as the task is added
+  std::atomic<bool> bExecuted = false;
+  std::chrono::steady_clock::time_point addTime = std::chrono::steady_clock::now();
+  std::atomic<int64_t> latencyUsec = 0;
+  pThreadPool->addTask( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){
+    latencyUsec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - addTime ).count();
+    bExecuted = true;
+  } ) );
+  for( int i = 0; i < 1000 && !bExecuted; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE( bExecuted );
+  std::cout << "wake up latency:" << std::to_string( latencyUsec ) << "usec" << std::endl;
+
+  pThreadPool->terminate();
+}
+
+class CountTask : public ITask
+{
+protected:
+  std::atomic<int>& mCounter;
+public:
+  CountTask( std::atomic<int>& counter ) : mCounter( counter ){};
+  virtual void onExecute(void){ mCounter++; };
+};
+
+#if defined(__linux__)
+// the CPUs which the calling thread is allowed to run on
+static std::vector<int> getThreadCpus(void)
+{
+  std::vector<int> result;
+  cpu_set_t cpuset;
+  CPU_ZERO( &cpuset );
+  if( pthread_getaffinity_np( pthread_self(), sizeof( cpuset ), &cpuset ) == 0 ){
+    for( int i = 0; i < CPU_SETSIZE; i++ ){
+      if( CPU_ISSET( i, &cpuset ) ){
+        result.push_back( i );
+      }
+    }
+  }
+  return result;
+}
+
+TEST_F(TestCase_TaskManager, testThreadPoolAffinity)
+{
+  std::vector<int> cpus = ThreadPool::getAvailableCpus();
+  ASSERT_FALSE( cpus.empty() );
+
+  // round robin : each worker is pinned to the single CPU from the start
+  ThreadPool::Config config( 2 );
+  config.affinityPolicy = ThreadPool::AFFINITY_ROUND_ROBIN;
+  config.cpus = { cpus.back() };
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( config );
+  std::vector<Future<std::vector<int>>> futures;
+  for( int i = 0; i < 8; i++ ){
+    futures.push_back( pThreadPool->submit( [](){ return getThreadCpus(); } ) );
+  }
+  pThreadPool->execute();
+  for( auto& future : futures ){
+    EXPECT_EQ( future.get(), std::vector<int>( { cpus.back() } ) );
+  }
+  pThreadPool->terminate();
+
+  // explicit : the worker without the entry isn't pinned
+  ThreadPool::Config explicitConfig( 1 );
+  explicitConfig.affinityPolicy = ThreadPool::AFFINITY_EXPLICIT;
+  explicitConfig.workerCpus = { { cpus.front() } };
+  pThreadPool = std::make_shared<ThreadPool>( explicitConfig );
+  pThreadPool->execute();
+  EXPECT_EQ( pThreadPool->submit( [](){ return getThreadCpus(); } ).get(), std::vector<int>( { cpus.front() } ) );
+  pThreadPool->terminate();
+
+  // the period's thread is pinned even after it's started
+  std::mutex mutex;
+  std::vector<int> periodCpus;
+  std::shared_ptr<PeriodicTaskManager> pPeriodicTaskMan = std::make_shared<PeriodicTaskManager>();
+  pPeriodicTaskMan->scheduleRepeat( std::make_shared<LambdaTask>( [&mutex, &periodCpus](std::shared_ptr<Task> pTask){
+    std::lock_guard<std::mutex> lock( mutex );
+    periodCpus = getThreadCpus();
+  } ), std::chrono::milliseconds( 5 ) );
+  pPeriodicTaskMan->execute();
+  std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+  EXPECT_TRUE( pPeriodicTaskMan->setAffinity( std::chrono::milliseconds( 5 ), { cpus.front() } ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 30 ) );
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    EXPECT_EQ( periodCpus, std::vector<int>( { cpus.front() } ) );
+  }
+  pPeriodicTaskMan->terminate();
+}
+#endif /* __linux__ */
+
+TEST_F(TestCase_TaskManager, testTaskPool)
+{
+  std::atomic<int> counter = 0;
+  ThreadPool::TaskPool taskPool;
+  std::shared_ptr<ITask> pTaskA = std::make_shared<CountTask>( counter );
+  std::shared_ptr<ITask> pTaskB = std::make_shared<CountTask>( counter );
+
+  // FIFO and the cancellation only affects the already enqueued entries
+  taskPool.enqueue( pTaskA );
+  taskPool.enqueue( pTaskB );
+  taskPool.enqueue( pTaskA );
+  EXPECT_TRUE( taskPool.erase( pTaskA ) );
+  EXPECT_FALSE( taskPool.erase( pTaskA ) );
+  taskPool.enqueue( pTaskA );
+  EXPECT_EQ( taskPool.dequeue(), pTaskB );
+  EXPECT_EQ( taskPool.dequeue(), pTaskA );
+  EXPECT_EQ( taskPool.dequeue(), nullptr );
+  EXPECT_TRUE( taskPool.isEmpty() );
+
+  // draining the large queue should be linear
+  const int nNumOfTasks = 200000;
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    taskPool.enqueue( pTaskA );
+  }
+  int nDequeued = 0;
+  while( taskPool.dequeue() ){
+    nDequeued++;
+  }
+  std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+  std::cout << "enqueue/dequeue " << std::to_string( nNumOfTasks ) << " tasks:" << std::to_string( duration.count() ) << "msec" << std::endl;
+  EXPECT_EQ( nDequeued, nNumOfTasks );
+  EXPECT_LT( duration.count(), 2000 );
+}
+
+TEST_F(TestCase_TaskManager, testLockFreeTaskPool)
+{
+  std::atomic<int> counter = 0;
+  std::shared_ptr<LockFreeTaskPool> pTaskPool = std::make_shared<LockFreeTaskPool>( 1024 );
+  std::shared_ptr<ITask> pTaskA = std::make_shared<CountTask>( counter );
+  std::shared_ptr<ITask> pTaskB = std::make_shared<CountTask>( counter );
+
+  pTaskPool->enqueue( pTaskA );
+  pTaskPool->enqueue( pTaskB );
+  pTaskPool->erase( pTaskA );
+  pTaskPool->enqueue( pTaskA );
+  EXPECT_EQ( pTaskPool->dequeue(), pTaskB );
+  EXPECT_EQ( pTaskPool->dequeue(), pTaskA );
+  EXPECT_EQ( pTaskPool->dequeue(), nullptr );
+  EXPECT_TRUE( pTaskPool->isEmpty() );
+
+  // multiple producers exceeding the capacity
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 4, pTaskPool );
+  pThreadPool->execute();
+
+  const int nNumOfProducers = 4;
+  const int nNumOfTasks = 10000;
+  std::vector<std::thread> producers;
+  for( int i = 0; i < nNumOfProducers; i++ ){
+    producers.push_back( std::thread( [&](){
+      std::shared_ptr<ITask> pTask = std::make_shared<CountTask>( counter );
+      for( int j = 0; j < nNumOfTasks; j++ ){
+        pThreadPool->addTask( pTask );
+      }
+    } ) );
+  }
+  for( auto& aThread : producers ){
+    aThread.join();
+  }
+  for( int i = 0; i < 10000 && counter < nNumOfProducers * nNumOfTasks; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ( counter, nNumOfProducers * nNumOfTasks );
+
+  pThreadPool->terminate();
+}
+
+static void spawnRecursively(std::shared_ptr<ThreadPool> pThreadPool, std::atomic<int>& counter, int nDepth)
+{
+  pThreadPool->addTask( std::make_shared<LambdaTask>( [pThreadPool, &counter, nDepth](std::shared_ptr<Task> pTask){
+    counter++;
+    if( nDepth > 0 ){
+      spawnRecursively( pThreadPool, counter, nDepth - 1 );
+      spawnRecursively( pThreadPool, counter, nDepth - 1 );
+    }
+  } ) );
+}
+
+TEST_F(TestCase_TaskManager, testPriorityTaskPool)
+{
+  // the higher priority first and FIFO in the same priority
+  std::mutex mutex;
+  std::vector<int> order;
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 1, std::make_shared<PriorityTaskPool>() );
+  const int priorities[] = { ITask::PRIORITY_LOW, ITask::PRIORITY_NORMAL, ITask::PRIORITY_LOW, ITask::PRIORITY_CRITICAL, ITask::PRIORITY_HIGH, ITask::PRIORITY_NORMAL };
+  for( int i = 0; i < 6; i++ ){
+    std::shared_ptr<Task> pTask = std::make_shared<LambdaTask>( [&mutex, &order, i](std::shared_ptr<Task> pTask){
+      std::lock_guard<std::mutex> lock( mutex );
+      order.push_back( i );
+    } );
+    pTask->setPriority( priorities[i] );
+    pThreadPool->addTask( pTask );
+  }
+  pThreadPool->execute();
+  while( true ){
+    std::lock_guard<std::mutex> lock( mutex );
+    if( order.size() == 6 ) break;
+  }
+  pThreadPool->terminate();
+  EXPECT_EQ( order, std::vector<int>( { 3, 4, 1, 5, 0, 2 } ) );
+
+  // aging : the low priority task waiting 4 intervals beats the new high priority task
+  PriorityTaskPool taskPool( std::chrono::milliseconds( 10 ) );
+  std::shared_ptr<Task> pLowTask = std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  std::shared_ptr<Task> pHighTask = std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  pLowTask->setPriority( ITask::PRIORITY_LOW );
+  pHighTask->setPriority( ITask::PRIORITY_HIGH );
+  taskPool.enqueue( pLowTask );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 40 ) );
+  taskPool.enqueue( pHighTask );
+  EXPECT_EQ( taskPool.getDepth(), 2 );
+  EXPECT_EQ( taskPool.dequeue(), pLowTask );
+  EXPECT_EQ( taskPool.dequeue(), pHighTask );
+  EXPECT_TRUE( taskPool.isEmpty() );
+
+  // the erased task is skipped
+  taskPool.enqueue( pHighTask );
+  taskPool.enqueue( pLowTask );
+  taskPool.erase( pHighTask );
+  EXPECT_EQ( taskPool.dequeue(), pLowTask );
+  EXPECT_EQ( taskPool.dequeue(), nullptr );
+
+  // InplaceTask waits while the higher priority task is queued
+  InplaceTask inplaceTask;
+  taskPool.enqueueInplace( InplaceTask( [](){} ) );
+  taskPool.enqueue( pHighTask );
+  EXPECT_FALSE( taskPool.dequeueInplace( inplaceTask ) );
+  EXPECT_EQ( taskPool.dequeue(), pHighTask );
+  EXPECT_TRUE( taskPool.dequeueInplace( inplaceTask ) );
+  EXPECT_TRUE( taskPool.isEmpty() );
+
+  // TaskManager dispatches the waiting tasks by the priority
+  order.clear();
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( 1 );
+  for( int i = 0; i < 6; i++ ){
+    std::shared_ptr<Task> pTask = std::make_shared<LambdaTask>( [&mutex, &order, i](std::shared_ptr<Task> pTask){
+      std::lock_guard<std::mutex> lock( mutex );
+      order.push_back( i );
+    } );
+    pTask->setPriority( priorities[i] );
+    pTaskMan->addTask( pTask );
+  }
+  pTaskMan->executeAllTasks();
+  while( pTaskMan->isRunning() || pTaskMan->isRemainingTasks() ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  pTaskMan->finalize();
+  EXPECT_EQ( order, std::vector<int>( { 3, 4, 1, 5, 0, 2 } ) );
+}
+
+class CompletionCountTask : public ITask
+{
+public:
+  std::atomic<int> mNumOfExecuted = 0;
+  std::atomic<int> mNumOfCompleted = 0;
+  virtual void onExecute(void){ mNumOfExecuted++; };
+  virtual void onComplete(void){ mNumOfCompleted++; };
+};
+
+TEST_F(TestCase_TaskManager, testDeadlineTaskPool)
+{
+  // the earliest deadline first, and the task without the deadline at last
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::shared_ptr<DeadlineTaskPool> pTaskPool = std::make_shared<DeadlineTaskPool>();
+  std::vector<std::shared_ptr<ITask>> tasks;
+  const int deadlines[] = { 30, 0, 10, 20 };
+  for( int i = 0; i < 4; i++ ){
+    tasks.push_back( std::make_shared<CompletionCountTask>() );
+    if( deadlines[i] ){
+      tasks.back()->setDeadline( now + std::chrono::seconds( deadlines[i] ) );
+    }
+    pTaskPool->enqueue( tasks.back() );
+  }
+  EXPECT_EQ( pTaskPool->getDepth(), 4 );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[2] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[3] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[0] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[1] );
+  EXPECT_TRUE( pTaskPool->isEmpty() );
+
+  // erase() removes the entries at once, the heap needn't be drained
+  pTaskPool->enqueue( tasks[0] );
+  pTaskPool->enqueue( tasks[2] );
+  pTaskPool->erase( tasks[2] );
+  EXPECT_EQ( pTaskPool->getDepth(), 1 );
+  pTaskPool->enqueue( tasks[2] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[2] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[0] );
+  EXPECT_TRUE( pTaskPool->isEmpty() );
+
+  // the missed task is dropped with onComplete()
+  std::shared_ptr<CompletionCountTask> pMissedTask = std::make_shared<CompletionCountTask>();
+  pMissedTask->setDeadline( now - std::chrono::milliseconds( 1 ) );
+  pTaskPool->enqueue( pMissedTask );
+  pTaskPool->enqueue( tasks[0] );
+  EXPECT_EQ( pTaskPool->dequeue(), tasks[0] );
+  EXPECT_TRUE( pMissedTask->isDeadlineMissed() );
+  EXPECT_EQ( pMissedTask->mNumOfCompleted, 1 );
+  EXPECT_EQ( pTaskPool->getNumOfDeadlineMisses(), 1 );
+
+  // the Future of the dropped task throws DeadlineMissedException
+  auto func = [](){ return 1; };
+  std::shared_ptr<PackagedTask<int, decltype(func)>> pPackagedTask = std::make_shared<PackagedTask<int, decltype(func)>>( std::move( func ) );
+  Future<int> future( pPackagedTask );
+  pPackagedTask->setDeadline( now - std::chrono::milliseconds( 1 ) );
+  pTaskPool->enqueue( pPackagedTask );
+  EXPECT_EQ( pTaskPool->dequeue(), nullptr );
+  EXPECT_TRUE( future.isReady() );
+  EXPECT_THROW( future.get(), DeadlineMissedException );
+
+  // the dropped Task ends like the executed one : the in-flight flag is released and the waiter returns
+  std::shared_ptr<Task> pDroppedTask = std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  pDroppedTask->setDeadline( now - std::chrono::milliseconds( 1 ) );
+  EXPECT_TRUE( pDroppedTask->tryMarkInFlight() );
+  pTaskPool->enqueue( pDroppedTask );
+  EXPECT_EQ( pTaskPool->dequeue(), nullptr );
+  EXPECT_TRUE( pDroppedTask->waitForCompletion( std::chrono::seconds( 1 ) ) );
+  EXPECT_TRUE( pDroppedTask->tryMarkInFlight() );
+
+  // TaskManager releases the slot of the dropped task and runs the next one
+  std::atomic<int> counter = 0;
+  std::shared_ptr<ThreadPool> pDeadlineThreadPool = std::make_shared<ThreadPool>( 1, std::make_shared<DeadlineTaskPool>() );
+  std::shared_ptr<TaskManager> pTaskMan = std::make_shared<TaskManager>( 1, pDeadlineThreadPool );
+  std::shared_ptr<Task> pExpiredTask = std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter += 100; } );
+  pExpiredTask->setDeadline( now - std::chrono::milliseconds( 1 ) );
+  pTaskMan->addTask( pExpiredTask );
+  pTaskMan->addTask( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter++; } ) );
+  pTaskMan->executeAllTasks();
+  for( int i = 0; i < 1000 && counter < 1; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ( counter, 1 );
+  EXPECT_TRUE( pExpiredTask->isDeadlineMissed() );
+  pTaskMan->finalize();
+  pDeadlineThreadPool->terminate();
+
+  // the flag mode executes the missed task
+  std::shared_ptr<DeadlineTaskPool> pFlagTaskPool = std::make_shared<DeadlineTaskPool>( false );
+  std::shared_ptr<CompletionCountTask> pLateTask = std::make_shared<CompletionCountTask>();
+  ThreadPool threadPool( 1, pFlagTaskPool );
+  threadPool.addTask( pLateTask, std::chrono::steady_clock::now() - std::chrono::milliseconds( 1 ) );
+  threadPool.execute();
+  while( !pLateTask->mNumOfCompleted ){
+    std::this_thread::yield();
+  }
+  EXPECT_EQ( pLateTask->mNumOfExecuted, 1 );
+  EXPECT_TRUE( pLateTask->isDeadlineMissed() );
+  EXPECT_EQ( threadPool.getMetrics().nDeadlineMisses, 1 );
+  threadPool.terminate();
+}
+
+TEST_F(TestCase_TaskManager, testBatchTaskPool)
+{
+  // the erased task is skipped and the batch keeps FIFO in each TaskPool
+  std::vector<std::shared_ptr<ThreadPool::TaskPool>> taskPools = { std::make_shared<ThreadPool::TaskPool>(), std::make_shared<LockFreeTaskPool>(), std::make_shared<PriorityTaskPool>(), std::make_shared<DeadlineTaskPool>() };
+  for( auto& pTaskPool : taskPools ){
+    std::vector<std::shared_ptr<ITask>> tasks;
+    for( int i = 0; i < 10; i++ ){
+      tasks.push_back( std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} ) );
+    }
+    // the null task is skipped
+    tasks.push_back( nullptr );
+    pTaskPool->enqueueBatch( tasks );
+    EXPECT_EQ( pTaskPool->getDepth(), 10 );
+    pTaskPool->erase( tasks[1] );
+
+    std::vector<std::shared_ptr<ITask>> dequeuedTasks;
+    EXPECT_EQ( pTaskPool->dequeueBatch( dequeuedTasks, 4 ), 4 );
+    EXPECT_EQ( dequeuedTasks, std::vector<std::shared_ptr<ITask>>( { tasks[0], tasks[2], tasks[3], tasks[4] } ) );
+    EXPECT_EQ( pTaskPool->dequeueBatch( dequeuedTasks, 100 ), 5 );
+    EXPECT_EQ( dequeuedTasks.back(), tasks[9] );
+    EXPECT_TRUE( pTaskPool->isEmpty() );
+  }
+
+  // addTasks() with the batch dequeue executes all and the cancelled one is skipped by the TaskPool
+  const int nNumOfTasks = 1000;
+  std::atomic<int> counter = 0;
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  pThreadPool->setDequeueBatchSize( 8 );
+  pThreadPool->enableMetrics();
+  std::vector<std::shared_ptr<ITask>> tasks;
+  for( int i = 0; i < nNumOfTasks; i++ ){
+    tasks.push_back( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter++; } ) );
+  }
+  tasks.push_back( nullptr );
+  pThreadPool->addTasks( tasks );
+  pThreadPool->canceTask( tasks[ nNumOfTasks - 1 ] );
+  pThreadPool->execute();
+  std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+  while( counter < nNumOfTasks - 1 && std::chrono::steady_clock::now() < timeout ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  pThreadPool->terminate();
+  EXPECT_EQ( counter, nNumOfTasks - 1 );
+
+  // the task cancelled while the worker holds it in the batch is dropped from the batch
+  std::atomic<bool> bBlocking = true;
+  std::atomic<bool> bStarted = false;
+  std::shared_ptr<ThreadPool> pSingleThreadPool = std::make_shared<ThreadPool>( 1 );
+  pSingleThreadPool->setDequeueBatchSize( 8 );
+  std::vector<std::shared_ptr<ITask>> batchTasks;
+  batchTasks.push_back( std::make_shared<LambdaTask>( [&bBlocking, &bStarted](std::shared_ptr<Task> pTask){
+    bStarted = true;
+    while( bBlocking ){
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+  } ) );
+  counter = 0;
+  for( int i = 0; i < 7; i++ ){
+    batchTasks.push_back( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter++; } ) );
+  }
+  pSingleThreadPool->addTasks( batchTasks );
+  pSingleThreadPool->execute();
+  timeout = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+  while( !bStarted && std::chrono::steady_clock::now() < timeout ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  // the whole batch was taken at once, then the TaskPool has nothing to skip
+  EXPECT_EQ( pSingleThreadPool->getMetrics().nQueueDepth, 0 );
+  pSingleThreadPool->canceTask( batchTasks[3] );
+  bBlocking = false;
+  timeout = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+  while( counter < 6 && std::chrono::steady_clock::now() < timeout ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  pSingleThreadPool->terminate();
+  EXPECT_EQ( counter, 6 );
+}
+
+TEST_F(TestCase_TaskManager, testParallelAlgorithm)
+{
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 4 );
+  pThreadPool->execute();
+
+  // parallel_for matches the serial loop
+  const int nSize = 100000;
+  std::vector<int64_t> values( nSize, 0 );
+  std::vector<int64_t> expected( nSize, 0 );
+  for( int i = 0; i < nSize; i++ ){
+    expected[i] = (int64_t)i * i;
+  }
+  parallel_for( pThreadPool, 0, nSize, 64, [&values](int i){ values[i] = (int64_t)i * i; } );
+  EXPECT_EQ( values, expected );
+
+  // parallel_reduce matches the serial sum
+  int64_t nSum = parallel_reduce( pThreadPool, 0, nSize, 64, (int64_t)0, [&values](int nBegin, int nEnd, int64_t value){
+    for( int i = nBegin; i < nEnd; i++ ){
+      value += values[i];
+    }
+    return value;
+  }, [](int64_t a, int64_t b){ return a + b; } );
+  EXPECT_EQ( nSum, std::accumulate( expected.begin(), expected.end(), (int64_t)0 ) );
+
+  // the empty range and the null ThreadPool (serial)
+  int nCount = 0;
+  parallel_for( pThreadPool, 10, 10, 1, [&nCount](int i){ nCount++; } );
+  EXPECT_EQ( nCount, 0 );
+  parallel_for( std::shared_ptr<ThreadPool>(), 0, 100, 1, [&nCount](int i){ nCount++; } );
+  EXPECT_EQ( nCount, 100 );
+
+  // the exception of the body is rethrown by the caller
+  EXPECT_THROW( parallel_for( pThreadPool, 0, nSize, 16, [](int i){ if( i == 5000 ) throw std::runtime_error( "body" ); } ), std::runtime_error );
+
+  // the nested loop on the single worker doesn't deadlock since the caller helps
+  std::shared_ptr<ThreadPool> pSingleThreadPool = std::make_shared<ThreadPool>( 1 );
+  pSingleThreadPool->execute();
+  std::atomic<int> nNestedCount = 0;
+  parallel_for( pSingleThreadPool, 0, 8, 1, [&](int i){
+    parallel_for( pSingleThreadPool, 0, 100, 1, [&](int j){ nNestedCount++; } );
+  } );
+  EXPECT_EQ( nNestedCount, 800 );
+
+  pSingleThreadPool->terminate();
+  pThreadPool->terminate();
+}
+
+TEST_F(TestCase_TaskManager, testTaskGraph)
+{
+  // diamond : A -> ( B, C ) -> D
+  std::mutex mutex;
+  std::vector<char> order;
+  auto makeTask = [&mutex, &order](char name){
+    return std::make_shared<LambdaTask>( [&mutex, &order, name](std::shared_ptr<Task> pTask){
+      std::lock_guard<std::mutex> lock( mutex );
+      order.push_back( name );
+    } );
+  };
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 4 );
+  pThreadPool->execute();
+
+  TaskGraph graph;
+  std::shared_ptr<TaskGraph::Node> pA = graph.addNode( makeTask( 'A' ) );
+  std::shared_ptr<TaskGraph::Node> pB = graph.addNode( makeTask( 'B' ) );
+  std::shared_ptr<TaskGraph::Node> pC = graph.addNode( makeTask( 'C' ) );
+  std::shared_ptr<TaskGraph::Node> pD = graph.addNode( makeTask( 'D' ) );
+  pB->addPredecessor( pA );
+  pC->addPredecessor( pA );
+  pD->addPredecessor( pB );
+  pD->addPredecessor( pC );
+
+  // re-run the same graph
+  for( int i = 0; i < 3; i++ ){
+    order.clear();
+    EXPECT_TRUE( graph.run( pThreadPool ) );
+    graph.wait();
+    EXPECT_FALSE( graph.isRunning() );
+    ASSERT_EQ( order.size(), 4 );
+    EXPECT_EQ( order.front(), 'A' );
+    EXPECT_EQ( order.back(), 'D' );
+  }
+
+  // the wide graph : every node of the layer depends on every node of the previous layer
+  const int nNumOfLayers = 10;
+  const int nWidth = 8;
+  std::atomic<int> counter = 0;
+  std::atomic<bool> bOrdered = true;
+  TaskGraph wideGraph;
+  std::vector<std::shared_ptr<TaskGraph::Node>> prevLayer;
+  for( int nLayer = 0; nLayer < nNumOfLayers; nLayer++ ){
+    std::vector<std::shared_ptr<TaskGraph::Node>> layer;
+    for( int i = 0; i < nWidth; i++ ){
+      std::shared_ptr<TaskGraph::Node> pNode = wideGraph.addNode( std::make_shared<LambdaTask>( [&counter, &bOrdered, nLayer, nWidth](std::shared_ptr<Task> pTask){
+        if( counter.fetch_add( 1 ) / nWidth != nLayer ){
+          bOrdered = false;
+        }
+      } ) );
+      for( auto& pPredecessor : prevLayer ){
+        pNode->addPredecessor( pPredecessor );
+      }
+      layer.push_back( pNode );
+    }
+    prevLayer.swap( layer );
+  }
+  EXPECT_TRUE( wideGraph.run( pThreadPool ) );
+  wideGraph.wait();
+  EXPECT_EQ( counter, nNumOfLayers * nWidth );
+  EXPECT_TRUE( bOrdered );
+
+  // the cycle is rejected
+  TaskGraph cyclicGraph;
+  std::shared_ptr<TaskGraph::Node> pX = cyclicGraph.addNode( makeTask( 'X' ) );
+  std::shared_ptr<TaskGraph::Node> pY = cyclicGraph.addNode( makeTask( 'Y' ) );
+  pY->addPredecessor( pX );
+  pX->addPredecessor( pY );
+  EXPECT_FALSE( cyclicGraph.run( pThreadPool ) );
+
+  // the exception of the node is rethrown by wait() after the rest of the graph
+  TaskGraph failedGraph;
+  std::shared_ptr<TaskGraph::Node> pFailed = failedGraph.addNode( std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){ throw std::runtime_error( "failed" ); } ) );
+  failedGraph.addNode( makeTask( 'F' ) )->addPredecessor( pFailed );
+  order.clear();
+  EXPECT_TRUE( failedGraph.run( pThreadPool ) );
+  EXPECT_THROW( failedGraph.wait(), std::runtime_error );
+  EXPECT_FALSE( failedGraph.isRunning() );
+  EXPECT_EQ( order.size(), 1 );
+
+  // the running node and the node waiting for its predecessors are abandoned : each node is counted down only once,
+  // then wait() returns after the running node
+  std::atomic<bool> bReleased = false;
+  std::atomic<bool> bFinished = false;
+  TaskGraph blockedGraph;
+  std::shared_ptr<TaskGraph::Node> pBlocked = blockedGraph.addNode( std::make_shared<LambdaTask>( [&bReleased, &bFinished](std::shared_ptr<Task> pTask){
+    while( !bReleased ){
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bFinished = true;
+  } ) );
+  std::shared_ptr<TaskGraph::Node> pWaiting = blockedGraph.addNode( makeTask( 'W' ) );
+  pWaiting->addPredecessor( pBlocked );
+  blockedGraph.addNode( makeTask( 'V' ) )->addPredecessor( pWaiting );
+  order.clear();
+  EXPECT_TRUE( blockedGraph.run( pThreadPool ) );
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  pBlocked->onAbandon();
+  pWaiting->onAbandon();
+  pWaiting->onAbandon();
+  bReleased = true;
+  EXPECT_THROW( blockedGraph.wait(), std::future_error );
+  EXPECT_TRUE( bFinished );
+  EXPECT_TRUE( order.empty() );
+
+  pThreadPool->terminate();
+
+  // the nodes dropped by terminate() complete the graph without running
+  std::shared_ptr<ThreadPool> pIdleThreadPool = std::make_shared<ThreadPool>( 1 );
+  order.clear();
+  EXPECT_TRUE( graph.run( pIdleThreadPool ) );
+  pIdleThreadPool->terminate();
+  EXPECT_THROW( graph.wait(), std::future_error );
+  EXPECT_TRUE( order.empty() );
+  EXPECT_TRUE( graph.run( pIdleThreadPool ) );
+  EXPECT_THROW( graph.wait(), std::future_error );
+}
+
+TEST_F(TestCase_TaskManager, testWorkStealingThreadPool)
+{
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 4, true );
+  pThreadPool->execute();
+
+  const int nDepth = 12;
+  const int nExpected = ( 1 << ( nDepth + 1 ) ) - 1;
+  std::atomic<int> counter = 0;
+  spawnRecursively( pThreadPool, counter, nDepth );
+
+  for( int i = 0; i < 10000 && counter < nExpected; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ( counter, nExpected );
+  pThreadPool->terminate();
+
+  // the cancel mark lives only while the task is in any deque
+  WorkStealingGroup group( 1 );
+  std::shared_ptr<Task> pLocalTask = std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  std::shared_ptr<Task> pOtherTask = std::make_shared<LambdaTask>( [](std::shared_ptr<Task> pTask){} );
+  EXPECT_FALSE( group.cancel( pOtherTask ) );
+  EXPECT_FALSE( group.hasCancelledTask() );
+  EXPECT_TRUE( group.push( group.getDeque( 0 ), pLocalTask ) );
+  EXPECT_TRUE( group.push( group.getDeque( 0 ), pLocalTask ) );
+  EXPECT_TRUE( group.cancel( pLocalTask ) );
+  EXPECT_TRUE( group.hasCancelledTask() );
+  EXPECT_TRUE( group.isCancelled( group.getDeque( 0 )->pop() ) );
+  EXPECT_TRUE( group.hasCancelledTask() );
+  EXPECT_TRUE( group.isCancelled( group.getDeque( 0 )->pop() ) );
+  EXPECT_FALSE( group.hasCancelledTask() );
+
+  // the parent blocking on its child : the child pushed to the parent's own deque wakes up the parked worker to steal it
+  pThreadPool = std::make_shared<ThreadPool>( 2, true );
+  pThreadPool->execute();
+  for( int i = 0; i < 200; i++ ){
+    Future<int> parent = pThreadPool->submit( [pThreadPool](){
+      return pThreadPool->submit( [](){ return 1; } ).get();
+    } );
+    Future<void> sibling = pThreadPool->submit( [](){ std::this_thread::sleep_for( std::chrono::microseconds( 100 ) ); } );
+    ASSERT_EQ( parent.wait_for( std::chrono::seconds( 5 ) ), std::future_status::ready );
+    EXPECT_EQ( parent.get(), 1 );
+    sibling.wait();
+  }
+  pThreadPool->terminate();
+}
+
+TEST_F(TestCase_TaskManager, testTimingWheel)
+{
+  std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>( 2 );
+  std::shared_ptr<TimingWheel> pTimingWheel = std::make_shared<TimingWheel>( pThreadPool );
+  pThreadPool->execute();
+  pTimingWheel->execute();
+
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  std::atomic<int64_t> firedMsec50 = 0, firedMsec300 = 0;
+  std::atomic<int> numOfCancelled = 0;
+  auto getElapsedMsec = [startTime](){
+    return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+  };
+
+  // one shot including the deadline beyond the lowest level
+  pTimingWheel->schedule( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){ firedMsec50 = getElapsedMsec(); } ), 50 );
+  pTimingWheel->schedule( std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){ firedMsec300 = getElapsedMsec(); } ), 300 );
+  std::shared_ptr<Task> pCancelledTask = std::make_shared<LambdaTask>( [&](std::shared_ptr<Task> pTask){ numOfCancelled++; } );
+  pTimingWheel->schedule( pCancelledTask, 100 );
+  pTimingWheel->cancel( pCancelledTask );
+  EXPECT_FALSE( pTimingWheel->isScheduled( pCancelledTask ) );
+
+  // many periodic timers at the various periods share the single wheel thread
+  const int nNumOfTimers = 200;
+  std::vector<std::atomic<int>> counters( nNumOfTimers );
+  std::vector<std::shared_ptr<Task>> periodicTasks;
+  for( int i = 0; i < nNumOfTimers; i++ ){
+    std::atomic<int>& counter = counters[i];
+    periodicTasks.push_back( std::make_shared<LambdaTask>( [&counter](std::shared_ptr<Task> pTask){ counter++; } ) );
+    pTimingWheel->schedule( periodicTasks.back(), 10 + i, 10 + i );
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for( auto& pTask : periodicTasks ){
+    pTimingWheel->cancel( pTask );
+  }
+  pTimingWheel->terminate();
+  pThreadPool->terminate();
+
+  std::cout << "one shot 50msec fired at " << std::to_string( firedMsec50 ) << "msec, 300msec fired at " << std::to_string( firedMsec300 ) << "msec" << std::endl;
+  EXPECT_GE( firedMsec50, 50 );
+  EXPECT_LT( firedMsec50, 150 );
+  EXPECT_GE( firedMsec300, 300 );
+  EXPECT_LT( firedMsec300, 400 );
+  EXPECT_EQ( numOfCancelled, 0 );
+  for( int i = 0; i < nNumOfTimers; i++ ){
+    EXPECT_GE( counters[i], 1 );
+  }
+  std::cout << "10msec period fired " << std::to_string( counters[0] ) << " times in 500msec" << std::endl;
+  EXPECT_GE( counters[0], 30 );
+
+  // the expiry while the previous one is still queued behind the busy worker is coalesced instead of queued again
+  std::shared_ptr<ThreadPool> pSingleThreadPool = std::make_shared<ThreadPool>( 1 );
+  std::shared_ptr<TimingWheel> pSingleTimingWheel = std::make_shared<TimingWheel>( pSingleThreadPool );
+  pSingleThreadPool->execute();
+  pSingleTimingWheel->execute();
+  std::atomic<bool> bBlocked = false;
+  pSingleThreadPool->addTask( std::make_shared<LambdaTask>( [&bBlocked](std::shared_ptr<Task> pTask){
+    bBlocked = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bBlocked = false;
+  } ) );
+  std::atomic<int> coalescedCounter = 0;
+  std::shared_ptr<Task> pCoalescedTask = std::make_shared<LambdaTask>( [&coalescedCounter](std::shared_ptr<Task> pTask){ coalescedCounter++; } );
+  pSingleTimingWheel->schedule( pCoalescedTask, 1, 1 );
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  pSingleTimingWheel->cancel( pCoalescedTask );
+  pSingleTimingWheel->terminate();
+  pSingleThreadPool->terminate();
+  std::cout << "1msec period fired " << std::to_string( coalescedCounter ) << " times behind the 50msec task" << std::endl;
+  EXPECT_GE( coalescedCounter, 1 );
+  EXPECT_LE( coalescedCounter, 20 );
+}
+
 
 TEST_F(TestCase_TaskManager, testPeridocTaskManager)
 {
@@ -239,7 +1597,7 @@ TEST_F(TestCase_TaskManager, testTimer)
       MyTimer(int nDelayMsec, bool bRepeat = false):Timer(nDelayMsec, bRepeat){};
       virtual ~MyTimer(){};
       virtual void onExecute(void){
-        std::cout << "MyTimer (" << std::to_string( reinterpret_cast<uint64_t>( shared_from_this().get() ) ) << "):" << std::to_string( mDelayMsec ) << " msec" << std::endl;
+        std::cout << "MyTimer (" << std::to_string( reinterpret_cast<uint64_t>( shared_from_this().get() ) ) << "):" << std::to_string( std::chrono::duration_cast<std::chrono::milliseconds>( mDelay ).count() ) << " msec" << std::endl;
       }
   };
 
@@ -299,6 +1657,83 @@ TEST_F(TestCase_TaskManager, testLambdaTimer)
   timers.clear();
 }
 
+TEST_F(TestCase_TaskManager, testOneShotTimers)
+{
+  // the pending one shot timers don't occupy the thread pool's workers
+  const int nNumOfTimers = 1000;
+  std::atomic<int> counter = 0;
+  TASK_LAMBDA task = [&counter](std::shared_ptr<Task> pTask){
+    counter++;
+  };
+
+  std::vector<std::shared_ptr<LambdaTimer>> timers;
+  for( int i = 0; i < nNumOfTimers; i++ ){
+    timers.push_back( std::make_shared<LambdaTimer>( task, 200, false ) );
+  }
+  std::shared_ptr<LambdaTimer> pCancelledTimer = std::make_shared<LambdaTimer>( [&counter](std::shared_ptr<Task> pTask){ counter += nNumOfTimers; }, 100, false );
+
+  for( auto& pTimer : timers ){
+    pTimer->schedule();
+  }
+  pCancelledTimer->schedule();
+  pCancelledTimer->cancelSchedule();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_EQ( counter, nNumOfTimers );
+
+  for( auto& pTimer : timers ){
+    pTimer->cancelSchedule();
+  }
+  timers.clear();
+}
+
+TEST_F(TestCase_TaskManager, testRearmedOneShotTimer)
+{
+  // the one shot timer re-armed by its own callback expires while the callback is still running, and it must not be coalesced
+  const int nNumOfFires = 5;
+  std::atomic<int> counter = 0;
+  std::shared_ptr<LambdaTimer> pTimer = std::make_shared<LambdaTimer>( [&counter](std::shared_ptr<Task> pTask){
+    if( ++counter < nNumOfFires ){
+      std::dynamic_pointer_cast<Timer>( pTask )->schedule();
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }, 2, false );
+
+  pTimer->schedule();
+  for( int i = 0; i < 100 && counter < nNumOfFires; i++ ){
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::cout << "re-armed one shot timer fired " << std::to_string( counter ) << " times" << std::endl;
+  EXPECT_EQ( counter, nNumOfFires );
+  pTimer->cancelSchedule();
+}
+
+TEST_F(TestCase_TaskManager, testHighResolutionTimer)
+{
+  std::atomic<int> counter = 0;
+  std::atomic<int> selfCancelCounter = 0;
+
+  std::shared_ptr<LambdaTimer> pTimer = std::make_shared<LambdaTimer>( [&counter](std::shared_ptr<Task> pTask){ counter++; }, std::chrono::microseconds( 500 ), true );
+  // the timer can cancel itself in the callback
+  std::shared_ptr<LambdaTimer> pSelfCancelTimer = std::make_shared<LambdaTimer>( [&selfCancelCounter](std::shared_ptr<Task> pTask){
+    if( ++selfCancelCounter == 10 ){
+      std::dynamic_pointer_cast<Timer>( pTask )->cancelSchedule();
+    }
+  }, std::chrono::microseconds( 200 ), true );
+
+  pTimer->schedule();
+  pSelfCancelTimer->schedule();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  pTimer->cancelSchedule();
+  int nCount = counter;
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  std::cout << "500usec timer fired " << std::to_string( nCount ) << " times in 100msec" << std::endl;
+  EXPECT_GE( nCount, 150 );
+  EXPECT_EQ( counter, nCount );
+  EXPECT_EQ( selfCancelCounter, 10 );
+}
+
 
 int main(int argc, char **argv)
 {
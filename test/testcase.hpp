@@ -28,13 +28,38 @@ protected:
   virtual void TearDown();
 
   void testTaskManager(void);
+  void testTaskManagerReuseThreads(void);
+  void testTaskCompletion(void);
   void testPeridocTask(void);
+  void testPeriodicTaskOverrunPolicy(void);
+  void testPeriodicTaskStatistics(void);
+  void testPeriodicTaskDrift(void);
+  void testParallelPeriodicTask(void);
+  void testHighResolutionPeriodicTask(void);
   void testThreadPool(void);
+  void testThreadPoolIdle(void);
+  void testFuture(void);
+  void testCoroutine(void);
+  void testInplaceTask(void);
+  void testObjectPool(void);
+  void testThreadPoolMetrics(void);
+  void testThreadPoolAffinity(void);
+  void testTaskPool(void);
+  void testLockFreeTaskPool(void);
+  void testPriorityTaskPool(void);
+  void testDeadlineTaskPool(void);
+  void testBatchTaskPool(void);
+  void testParallelAlgorithm(void);
+  void testTaskGraph(void);
+  void testWorkStealingThreadPool(void);
+  void testTimingWheel(void);
   void testPeridocTaskManager(void);
   void testPeridocTaskManagerCancel(void);
   void testLambdaTask(void);
   void testTimer(void);
   void testLambdaTimer(void);
+  void testOneShotTimers(void);
+  void testHighResolutionTimer(void);
 };
 
 #endif /* __TESTCASE_TASKMAN_HPP__ */